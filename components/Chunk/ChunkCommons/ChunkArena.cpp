@@ -0,0 +1,31 @@
+#include "ChunkArena.h"
+
+#include <cstring>
+#include <numeric>
+#include <omp.h>
+
+Chunk::ChunkArena Chunk::BuildArena(const std::vector<ChunkView> &views, int max_workers)
+{
+    const long long n = (long long)views.size();
+    ChunkArena arena;
+    arena.offsets.assign(views.size() + 1, 0);
+    for (size_t i = 0; i < views.size(); ++i)
+        arena.offsets[i + 1] = views[i].length;
+    std::inclusive_scan(arena.offsets.begin(), arena.offsets.end(), arena.offsets.begin());
+
+    // The fill overwrites every byte, so the buffer is not zeroed first
+    arena.bytes.resize_and_overwrite(arena.offsets.back(), [](char *, size_t size) { return size; });
+
+    int max_threads = omp_get_max_threads();
+    if (max_workers > 0 && max_workers < max_threads)
+    {
+        max_threads = max_workers;
+    }
+#pragma omp parallel for schedule(static) num_threads(max_threads)
+    for (long long i = 0; i < n; i++)
+    {
+        const std::string_view text = views[i].Text();
+        std::memcpy(arena.bytes.data() + arena.offsets[i], text.data(), text.size());
+    }
+    return arena;
+}
@@ -0,0 +1,34 @@
+#ifndef CHUNK_ARENA_H
+#define CHUNK_ARENA_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ChunkView.h"
+
+namespace Chunk
+{
+    /**
+     * Chunk texts packed back to back in one buffer: chunk i is
+     * bytes[offsets[i], offsets[i + 1]). Two allocations for any number of
+     * chunks; Python reads it through the buffer protocol without copies.
+     */
+    struct ChunkArena
+    {
+        std::string bytes;
+        std::vector<uint64_t> offsets{0}; // size() + 1 entries
+
+        inline size_t size() const { return offsets.size() - 1; }
+        inline std::string_view Text(size_t i) const
+        {
+            return std::string_view(bytes).substr(offsets.at(i), offsets.at(i + 1) - offsets[i]);
+        }
+    };
+
+    // Copies the text of every view into one arena, in order (count, prefix sum, parallel fill)
+    ChunkArena BuildArena(const std::vector<ChunkView> &views, int max_workers = 4);
+}
+
+#endif // CHUNK_ARENA_H
@@ -1,6 +1,9 @@
 #include "ChunkCommons.h"
 #include "RagException.h"
 #include "StringUtils.h"
+#include "Embedding/EmbeddingModel/InferencePool.h"
+#include "EmbeddingCache/EmbeddingCache.h"
+#include "VendorRegistry.h"
 
 #include <nlohmann/json.hpp>
 #include <onnxruntime/core/session/onnxruntime_cxx_api.h>
@@ -18,90 +21,94 @@
 
 using namespace Chunk;
 
-std::vector<RAGLibrary::Document> Chunk::Embeddings(const std::vector<RAGLibrary::Document>& list, std::string model)
-{     
-    std::vector<RAGLibrary::Document> emb;
-
+size_t Chunk::EmbedInto(const std::vector<std::string_view>& texts, const std::string& model, Embedding::EmbeddingSink& sink)
+{
     std::optional<std::string> vendor_opt = Chunk::resolve_vendor_from_model(model);
     if (!vendor_opt.has_value()) {
         throw std::invalid_argument("Model not supported.");
     }
     std::string vendor = vendor_opt.value();
 
-    if (vendor == "openai") {
-        int count = 0;
-        Chunk::InitAPIKey();
-        do {
-            try {
-                auto client = std::make_unique<EmbeddingOpenAI::EmbeddingOpenAI>();
-                emb = client->GenerateEmbeddings(list, model);
-            } catch (const std::exception& e) {
-                std::cerr << "[OpenAI::GenerateEmbeddings exception] "
-                          << e.what() << " (attempt " << count + 1 << ")\n";
-            }
-            count++;
-        } while (!Chunk::allChunksHaveEmbeddings(emb) && count < 3);
-
-        if (!Chunk::allChunksHaveEmbeddings(emb)) {
-            throw std::runtime_error("Failed to generate valid embeddings after 3 attempts.");
-        }
-
-        return emb;
+    // Cache hits are copied straight into their rows; only misses reach the provider. Local
+    // models may run an INT8 export, whose vectors must not mix with the fp32 ones.
+    std::string cache_model = model;
+    if (vendor == "huggingface" && Embedding::ModelRegistry::Instance().Precision(Chunk::LocalModelDir(model)) == "int8")
+        cache_model += "@int8";
+    auto cache = Embedding::EmbeddingCache::ForModel(cache_model);
+    std::vector<size_t> misses(texts.size());
+    std::iota(misses.begin(), misses.end(), size_t(0));
+    if (cache)
+        misses = cache->Fill(texts, sink);
+    if (misses.empty())
+        return texts.size();
+
+    std::vector<std::string_view> pending;
+    pending.reserve(misses.size());
+    for (size_t i : misses)
+        pending.push_back(texts[i]);
+    Embedding::RemappedSink missSink(sink, misses);
+
+    // Each finished batch is already in the sink and is persisted right away, so a rerun resumes
+    auto handler = Chunk::VendorRegistry::Instance().Get(vendor);
+    size_t done = 0;
+    try {
+        handler->Embed(pending, model, missSink, [&](size_t first, size_t count) {
+            done += count;
+            if (cache)
+                cache->Store(texts, std::vector<size_t>(misses.begin() + first, misses.begin() + first + count), sink);
+        });
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Failed to generate embeddings (" + std::to_string(done) + "/" +
+                                 std::to_string(pending.size()) + " completed): " + e.what());
     }
-
-    throw std::runtime_error("Vendor handler for '" + vendor + "' not implemented.");
+    return texts.size() - misses.size();
 }
 
-namespace RAGLibrary
-{   
-    static std::string FileReader(const std::string &filePath)
-    {
-        std::shared_ptr<std::ifstream> filePtr(new std::ifstream, [](std::ifstream *fil)
-                                               { fil->close(); });
-
-        try
-        {
-            filePtr->exceptions(std::ios::failbit);
-            filePtr->open(filePath, std::ios::in);
-            return {std::istreambuf_iterator<char>{*filePtr}, std::istreambuf_iterator<char>{}};
-        }
-        catch (const std::ios::failure &e)
-        {
-            std::osyncstream(std::cerr) << e.what() << std::endl;
-            throw RAGLibrary::RagException(e.what());
-        }
-        return std::string();
+std::vector<RAGLibrary::Document> Chunk::Embeddings(const std::vector<RAGLibrary::Document>& list, std::string model)
+{
+    std::vector<std::string_view> texts;
+    texts.reserve(list.size());
+    for (const auto& doc : list)
+        texts.push_back(doc.page_content);
+
+    std::vector<RAGLibrary::Document> emb = list;
+    for (auto& doc : emb)
+        doc.embedding.reset();
+    Embedding::DocumentSink sink(emb);
+    Chunk::EmbedInto(texts, model, sink);
+
+    if (!Chunk::allChunksHaveEmbeddings(emb)) {
+        throw std::runtime_error("Failed to generate valid embeddings.");
     }
 
-}
-
-template <typename T>
-inline Ort::Value CreateTensorOrt(Ort::AllocatorWithDefaultOptions &allocator,
-                                  std::vector<T> &data, std::vector<int64_t> &shape)
-{
-    return Ort::Value::CreateTensor<T>(allocator.GetInfo(), data.data(), data.size(), shape.data(), shape.size());
+    return emb;
 }
 
 std::vector<float> Chunk::MeanPooling(const std::vector<float> &token_embeddings, const std::vector<int64_t> &attention_mask, size_t embedding_size)
 {
-    size_t num_tokens = token_embeddings.size() / embedding_size;
+    size_t num_tokens = std::min(token_embeddings.size() / embedding_size, attention_mask.size());
     std::vector<float> pooled_embeddings(embedding_size, 0.0f);
+    float *pooled = pooled_embeddings.data();
 
-    for (int i = 0; i < num_tokens; ++i)
+    size_t valid_tokens = 0;
+    for (size_t i = 0; i < num_tokens; ++i)
     {
-        if (attention_mask[i] == 1)
+        if (attention_mask[i] != 1)
+            continue;
+        ++valid_tokens;
+        const float *token = token_embeddings.data() + i * embedding_size;
+#pragma omp simd
+        for (size_t j = 0; j < embedding_size; ++j)
         {
-            for (int j = 0; j < embedding_size; ++j)
-            {
-                pooled_embeddings[j] += token_embeddings[i * embedding_size + j];
-            }
+            pooled[j] += token[j];
         }
     }
 
-    int valid_tokens = std::accumulate(attention_mask.begin(), attention_mask.end(), 0);
-    for (int j = 0; j < embedding_size; ++j)
+    const float inv = 1.0f / float(std::max<size_t>(valid_tokens, 1));
+#pragma omp simd
+    for (size_t j = 0; j < embedding_size; ++j)
     {
-        pooled_embeddings[j] /= std::max(valid_tokens, 1);
+        pooled[j] *= inv;
     }
 
     return pooled_embeddings;
@@ -110,86 +117,79 @@ std::vector<float> Chunk::MeanPooling(const std::vector<float> &token_embeddings
 void Chunk::NormalizeEmbeddings(std::vector<float> &embeddings)
 {
     float norm = std::sqrt(std::inner_product(embeddings.begin(), embeddings.end(), embeddings.begin(), 0.0f));
+    if (norm == 0.0f)
+        return;
+    const float inv = 1.0f / norm;
     for (float &value : embeddings)
     {
-        value /= norm;
+        value *= inv;
     }
 }
 
-std::vector<std::vector<float>> Chunk::EmbeddingModelBatch(const std::vector<std::string> &chunks, const std::string &model, const int batch_size)
+void Chunk::MeanPoolNormalize(const float *token_embeddings, const int64_t *attention_mask, size_t rows, size_t seq_len, size_t dim, float *out)
 {
-    const auto model_c = model.c_str();
-    const std::string modelPath = std::format("models/{}/model.onnx", model_c);
-    const std::string tokenizerPath = std::format("models/{}/tokenizer.json", model_c);
-
-    auto env = std::make_shared<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "NER");
-    Ort::SessionOptions sessionOptions;
-    sessionOptions.SetInterOpNumThreads(1);
-
-    auto session = std::make_shared<Ort::Session>(*env, modelPath.c_str(), sessionOptions);
-    auto blob = RAGLibrary::FileReader(tokenizerPath);
-    auto tokenizer = tokenizers::Tokenizer::FromBlobJSON(blob);
-
-    Ort::AllocatorWithDefaultOptions allocator;
-
-    std::vector<std::vector<float>> results;
-    for (int start_idx = 0; start_idx < chunks.size(); start_idx += batch_size)
+    // The mean's 1/count factor cancels under L2 normalization, so each row is
+    // just the masked token sum scaled once by its inverse norm.
+    for (size_t r = 0; r < rows; ++r)
     {
-        size_t end_idx = std::min<ptrdiff_t>(start_idx + batch_size, chunks.size());
-        std::vector<std::string> texts(chunks.begin() + start_idx, chunks.begin() + end_idx);
-        auto encode_batch = tokenizer->EncodeBatch(chunks);
-
-        size_t total_size = std::accumulate(encode_batch.begin(), encode_batch.end(), std::size_t(0),
-                                            [](std::size_t sum, const std::vector<int32_t> &encode)
-                                            {
-                                                return sum + encode.size();
-                                            });
-
-        std::vector<int64_t> inputIds(total_size, 0);
-        std::vector<int64_t> attentionMask(total_size, 0);
-        size_t ii = 0;
-        for (int i = 0; i < encode_batch.size(); ++i)
+        float *acc = out + r * dim;
+        std::fill_n(acc, dim, 0.0f);
+
+        const float *tokens = token_embeddings + r * seq_len * dim;
+        const int64_t *mask = attention_mask + r * seq_len;
+        for (size_t t = 0; t < seq_len; ++t)
         {
-            for (auto index = 0; index < encode_batch[i].size(); ++index)
+            if (mask[t] == 0)
+                continue;
+            const float *token = tokens + t * dim;
+#pragma omp simd
+            for (size_t j = 0; j < dim; ++j)
             {
-                inputIds[ii + index] = encode_batch[i][index];
-                inputIds[ii + index] > 0 ? attentionMask[ii + index] = 1 : attentionMask[ii + index] = 0;
+                acc[j] += token[j];
             }
-            ii += encode_batch[i].size();
         }
-        std::vector<int64_t> tokenTypeIds(total_size, 0);
-        std::vector<int64_t> inputShape{int64_t(encode_batch.size()), int64_t(encode_batch.front().size())};
 
-        auto attentionTensor = CreateTensorOrt<int64_t>(allocator, attentionMask, inputShape);
-        auto inputTensor = CreateTensorOrt<int64_t>(allocator, inputIds, inputShape);
-        auto tokenTypeTensor = CreateTensorOrt<int64_t>(allocator, tokenTypeIds, inputShape);
-
-        std::vector<Ort::Value> inputTensors;
-        inputTensors.emplace_back(std::move(inputTensor));
-        inputTensors.emplace_back(std::move(attentionTensor));
-        inputTensors.emplace_back(std::move(tokenTypeTensor));
-
-        const char *inputNames[] = {"input_ids", "attention_mask", "token_type_ids"};
-        const char *outputNames[] = {"logits"};
-        std::vector<Ort::Value> outputTensors = session->Run(Ort::RunOptions(nullptr), inputNames, inputTensors.data(), 3, outputNames, 1);
-
-        float *logits = outputTensors.front().GetTensorMutableData<float>();
-        size_t outputSize = outputTensors.front().GetTensorTypeAndShapeInfo().GetElementCount();
+        float sq = 0.0f;
+#pragma omp simd reduction(+ : sq)
+        for (size_t j = 0; j < dim; ++j)
+        {
+            sq += acc[j] * acc[j];
+        }
+        if (sq == 0.0f)
+            continue;
 
-        results.reserve(results.size() + encode_batch.size());
-        ii = 0;
-        size_t numLabels = outputSize / total_size;
-        for (int i = 0; i < encode_batch.size(); i++)
+        const float inv = 1.0f / std::sqrt(sq);
+#pragma omp simd
+        for (size_t j = 0; j < dim; ++j)
         {
-            std::vector<float> tokenLogits(logits + ii * numLabels, logits + (ii + encode_batch[i].size()) * numLabels);
-            results.push_back(std::move(tokenLogits));
-            ii += encode_batch[i].size();
+            acc[j] *= inv;
         }
     }
+}
 
+std::vector<std::vector<float>> Chunk::EmbeddingModelBatch(const std::vector<std::string> &chunks, const std::string &model, const int batch_size)
+{
+    std::vector<std::string_view> views(chunks.begin(), chunks.end());
+    std::vector<float> matrix;
+    Embedding::MatrixSink sink(matrix, chunks.size());
+    EmbeddingModelBatch(views, model, sink, batch_size);
+
+    const size_t dim = sink.Dim();
+    std::vector<std::vector<float>> results(chunks.size());
+    for (size_t i = 0; i < chunks.size() && dim > 0; ++i)
+    {
+        results[i].assign(matrix.begin() + i * dim, matrix.begin() + (i + 1) * dim);
+    }
     return results;
 }
 
+void Chunk::EmbeddingModelBatch(const std::vector<std::string_view> &chunks, const std::string &model, Embedding::EmbeddingSink &sink, const int batch_size)
+{
+    // Same process-wide pool as EmbeddingModel and the "huggingface" vendor; its first
+    // worker is the registry session, so the model is loaded once per process
+    Embedding::InferencePool::Shared(model)->Embed(chunks, sink, batch_size);
+}
+
 std::vector<std::vector<float>> Chunk::EmbeddingOpeanAI(const std::vector<std::string> &chunks, const std::string &openai_api_key)
 {
     std::vector<std::vector<float>> results;
@@ -224,51 +224,84 @@ at::Tensor Chunk::toTensor(std::vector<std::vector<float>> &vect)
     return tensor;
 }
 
-std::vector<std::string> Chunk::SplitText(std::string inputs, const int overlap, const int chunk_size)
+std::vector<Chunk::ChunkSpan> Chunk::SplitTextSpans(std::string_view input, const int overlap, const int chunk_size)
 {
     size_t step = size_t(chunk_size - overlap);
-    size_t chunk_sizes = (size_t)std::ceil((long double)inputs.size() / (long double)(step));
+    size_t chunk_sizes = (size_t)std::ceil((long double)input.size() / (long double)(step));
 
-    std::vector<std::string> chunks(chunk_sizes);
+    std::vector<ChunkSpan> spans(chunk_sizes);
     for (size_t i = 0; i < chunk_sizes; ++i)
     {
         size_t start_index = i * step;
-        size_t end_index = start_index + chunk_size;
-        if (end_index >= inputs.size())
-        {
-            end_index = inputs.size();
-        }
-        chunks[i] = inputs.substr(start_index, end_index - start_index);
+        size_t end_index = std::min(start_index + size_t(chunk_size), input.size());
+        spans[i] = {start_index, end_index - start_index};
     }
 
-    return chunks;
+    return spans;
 }
 
-std::vector<std::string> Chunk::SplitTextByCount(const std::string &input, int overlap, int count_threshold, const std::shared_ptr<re2::RE2> regex)
+std::vector<Chunk::ChunkSpan> Chunk::SplitTextByCountSpans(std::string_view input, int overlap, int count_threshold, const re2::RE2 &regex)
 {
-    std::vector<std::string> chunks;
-    std::vector<re2::StringPiece> matches;
-
-    re2::StringPiece text(input);
+    // Each chunk ends after its count_threshold-th occurrence (the last one runs to the end of
+    // the input) and the next one starts `overlap` bytes before that. Chunks are cut during the
+    // scan: a group is only closed once a later occurrence shows it is not the last one, so no
+    // list of matches is kept.
+    const size_t threshold = size_t(std::max(count_threshold, 1));
+    std::vector<ChunkSpan> spans;
+    size_t start_idx = 0;
+    size_t in_group = 0;
+    size_t group_end = 0;
+
+    re2::StringPiece text(input.data(), input.size());
     re2::StringPiece match;
-
-    while (re2::RE2::FindAndConsume(&text, *regex, &match))
+    size_t pos = 0;
+    while (pos <= input.size() && regex.Match(text, pos, input.size(), re2::RE2::UNANCHORED, &match, 1))
     {
-        matches.push_back(match);
-    }
-
-    size_t start_idx = size_t(0);
-    for (int i = 0; i < matches.size(); i += count_threshold)
-    {
-        size_t j = i + count_threshold;
-        size_t end_idx = text.size() + 1;
-        if (j < matches.size())
+        const size_t match_end = size_t(match.data() - input.data()) + match.size();
+        if (in_group == threshold)
         {
-            end_idx = (matches[j - 1].data() - input.data()) + matches[j - 1].size();
+            spans.emplace_back(start_idx, group_end - start_idx);
+            start_idx = group_end > size_t(overlap) ? group_end - size_t(overlap) : size_t(0);
+            in_group = 0;
         }
-        chunks.push_back(std::string(text.substr(start_idx, end_idx - start_idx)));
-        start_idx = end_idx > overlap ? size_t(end_idx - overlap) : size_t(0);
+        if (++in_group == threshold)
+            group_end = match_end;
+        // Empty matches still advance
+        pos = match.empty() ? match_end + 1 : match_end;
     }
+    if (in_group > 0)
+        spans.emplace_back(start_idx, input.size() - start_idx);
+
+    return spans;
+}
+
+std::vector<std::string> Chunk::SplitText(const std::string &inputs, const int overlap, const int chunk_size)
+{
+    std::vector<std::string> chunks;
+    for (const auto &[offset, length] : SplitTextSpans(inputs, overlap, chunk_size))
+        chunks.emplace_back(inputs, offset, length);
+    return chunks;
+}
 
+std::vector<std::string> Chunk::SplitTextByCount(const std::string &input, int overlap, int count_threshold, const std::shared_ptr<re2::RE2> regex)
+{
+    std::vector<std::string> chunks;
+    for (const auto &[offset, length] : SplitTextByCountSpans(input, overlap, count_threshold, *regex))
+        chunks.emplace_back(input, offset, length);
     return chunks;
 }
+
+std::vector<float> Chunk::vdb_data::Project(const std::vector<float> &embedding) const
+{
+    if (reduction.empty() || embedding.size() == dim)
+        return embedding;
+    if (embedding.size() != source_dim)
+        throw std::invalid_argument("Embedding dimension " + std::to_string(embedding.size()) + " does not match the " + std::to_string(source_dim) + "-d source of this " + reduction + " element.");
+
+    std::vector<float> projected(dim);
+    if (reduction == "pca")
+        Chunk::ApplyPCA(pca, embedding.data(), 1, projected.data());
+    else
+        Chunk::TruncateNormalize(embedding.data(), 1, source_dim, dim, projected.data());
+    return projected;
+}
@@ -11,7 +11,12 @@
 #include <algorithm>
 #include <string>
 #include <cctype>
+#include <cstdint>
 #include "EmbeddingOpenAI.h"
+#include "Embedding/EmbeddingSink.h"
+#include "Reduction.h"
+#include "ChunkView.h"
+#include "ChunkArena.h"
 namespace Chunk
 {
     struct vdb_data {
@@ -20,6 +25,13 @@ namespace Chunk
         std::string model;
         size_t dim = 0;
         size_t n = 0;
+        // Deduplicated elements store each distinct chunk text once: chunk i → row row_of[i]
+        // of flatVD. Empty means one row per chunk.
+        std::vector<uint32_t> row_of;
+        // Reduced elements (ChunkDefault::ReduceEmb): "pca" or "matryoshka" of a source_dim element
+        std::string reduction;
+        size_t source_dim = 0;
+        PCAModel pca; // empty unless reduction == "pca"
         //----------------------------------------------------
         inline const std::tuple<size_t, size_t>  getPar(void) const{return { n, dim };}; 
         inline std::pair<std::string, std::string>getEmbPar(void) const{return { vendor , model };}; 
@@ -30,11 +42,17 @@ namespace Chunk
             }
             return flatVD.data();
         }; 
+        inline size_t getRowCount(void) const{ return dim ? flatVD.size() / dim : 0; };
+        inline const float* getRow(size_t chunk) const{
+            return flatVD.data() + (row_of.empty() ? chunk : row_of[chunk]) * dim;
+        };
+        // Maps a source_dim query embedding into this element's space (identity if unreduced)
+        std::vector<float> Project(const std::vector<float>& embedding) const;
     };
     
         extern inline const std::unordered_map<std::string, std::vector<std::string>> EmbeddingModel = {
             {"openai", {"text-embedding-ada-002", "text-embedding-3-small", "..."}},
-            {"huggingface", {"bge-small", "bge-large"}},
+            {"huggingface", {"bge-small", "bge-large", "all-MiniLM-L6-v2"}},
             {"cohere", {"embed-english-light-v3.0"}}
         };
  
@@ -106,12 +124,18 @@ namespace Chunk
         std::cerr << "API key set\n";
         #endif
     }
+    // Writes the embedding of texts[i] to sink.Row(i), serving what it can from the
+    // embedding cache; returns the number of cache hits.
+    size_t EmbedInto(const std::vector<std::string_view>& texts, const std::string& model, Embedding::EmbeddingSink& sink);
     std::vector<RAGLibrary::Document> Embeddings(const std::vector<RAGLibrary::Document>& list, std::string model);
    
     std::vector<float> MeanPooling(const std::vector<float> &token_embeddings, const std::vector<int64_t> &attention_mask, size_t embedding_size);
     void NormalizeEmbeddings(std::vector<float> &embeddings);
+    // Fused masked mean-pooling + L2 normalization of a [rows, seq_len, dim] batch into out[rows, dim]
+    void MeanPoolNormalize(const float *token_embeddings, const int64_t *attention_mask, size_t rows, size_t seq_len, size_t dim, float *out);
 
     std::vector<std::vector<float>> EmbeddingModelBatch(const std::vector<std::string> &chunks, const std::string &model, const int batch_size = 32);
+    void EmbeddingModelBatch(const std::vector<std::string_view> &chunks, const std::string &model, Embedding::EmbeddingSink &sink, const int batch_size = 32);
     inline std::vector<std::vector<float>> EmbeddingHuggingFaceTransformers(const std::vector<std::string> &chunks)
     {
         return EmbeddingModelBatch(chunks, "sentence-transformers/all-MiniLM-L6-v2");
@@ -120,7 +144,14 @@ namespace Chunk
 
     at::Tensor toTensor(std::vector<std::vector<float>> &vect);
 
-    std::vector<std::string> SplitText(std::string inputs, const int overlap, const int chunk_size);
+    // Chunk boundaries as (offset, length) spans of the input; the string versions copy them out.
+    std::vector<ChunkSpan> SplitTextSpans(std::string_view input, const int overlap, const int chunk_size);
+    std::vector<ChunkSpan> SplitTextByCountSpans(std::string_view input, int overlap, int count_threshold, const re2::RE2 &regex);
+    // Boundary-aware variant: cuts at the last paragraph break, else sentence end / line break, else
+    // whitespace, else a UTF-8 code point boundary within chunk_size; overlaps start on a word.
+    std::vector<ChunkSpan> SplitTextRecursiveSpans(std::string_view input, const int overlap, const int chunk_size);
+    std::vector<std::string> SplitText(const std::string &inputs, const int overlap, const int chunk_size);
+    std::vector<std::string> SplitTextRecursive(const std::string &input, const int overlap, const int chunk_size);
     std::vector<std::string> SplitTextByCount(const std::string &input, int overlap, int count_threshold, const std::shared_ptr<re2::RE2> regex);
     
 }
@@ -0,0 +1,64 @@
+#ifndef CHUNK_VIEW_H
+#define CHUNK_VIEW_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "CommonStructs.h"
+
+namespace Chunk
+{
+    // Text and metadata of one source document, shared (immutable) by all of its chunks.
+    struct SourceDocument
+    {
+        RAGLibrary::Metadata metadata;
+        std::string text;
+    };
+    using SourcePtr = std::shared_ptr<const SourceDocument>;
+
+    // (offset, length) of a chunk inside its source text
+    using ChunkSpan = std::pair<size_t, size_t>;
+
+    /**
+     * A chunk as (shared source buffer, offset, length). Overlapping chunks
+     * reference the same bytes; a std::string is only built by Str() or
+     * ToDocument(), when a caller actually needs one.
+     */
+    struct ChunkView
+    {
+        SourcePtr source;
+        size_t offset = 0;
+        size_t length = 0;
+
+        inline std::string_view Text() const { return std::string_view(source->text).substr(offset, length); }
+        inline std::string Str() const { return std::string(Text()); }
+        inline const RAGLibrary::Metadata &GetMetadata() const { return source->metadata; }
+        inline RAGLibrary::Document ToDocument() const { return RAGLibrary::Document(source->metadata, Str()); }
+    };
+
+    inline SourcePtr MakeSource(RAGLibrary::Metadata metadata, std::string text)
+    {
+        return std::make_shared<const SourceDocument>(SourceDocument{std::move(metadata), std::move(text)});
+    }
+
+    inline void AppendViews(const SourcePtr &source, const std::vector<ChunkSpan> &spans, std::vector<ChunkView> &out)
+    {
+        out.reserve(out.size() + spans.size());
+        for (const auto &[offset, length] : spans)
+            out.push_back(ChunkView{source, offset, length});
+    }
+
+    inline std::vector<RAGLibrary::Document> Materialize(const std::vector<ChunkView> &views)
+    {
+        std::vector<RAGLibrary::Document> documents;
+        documents.reserve(views.size());
+        for (const auto &view : views)
+            documents.push_back(view.ToDocument());
+        return documents;
+    }
+}
+
+#endif // CHUNK_VIEW_H
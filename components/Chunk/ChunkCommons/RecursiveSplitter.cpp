@@ -0,0 +1,162 @@
+#include "ChunkCommons.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // Last byte of [lo, hi) equal to one of Set..., or nullptr. Scans backwards a vector at a time.
+    template <char... Set>
+    const char *FindLastOf(const char *lo, const char *hi)
+    {
+#if defined(__AVX2__)
+        while (hi - lo >= 32)
+        {
+            const char *block = hi - 32;
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+            __m256i hit = _mm256_setzero_si256();
+            ((hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(Set)))), ...);
+            const uint32_t mask = uint32_t(_mm256_movemask_epi8(hit));
+            if (mask)
+                return block + 31 - std::countl_zero(mask);
+            hi = block;
+        }
+#endif
+#if defined(__SSE2__)
+        while (hi - lo >= 16)
+        {
+            const char *block = hi - 16;
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+            __m128i hit = _mm_setzero_si128();
+            ((hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(Set)))), ...);
+            const uint32_t mask = uint32_t(_mm_movemask_epi8(hit));
+            if (mask)
+                return block + 31 - std::countl_zero(mask);
+            hi = block;
+        }
+#endif
+        while (hi > lo)
+        {
+            --hi;
+            if (((*hi == Set) || ...))
+                return hi;
+        }
+        return nullptr;
+    }
+
+    inline bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+    }
+
+    inline bool IsContinuation(char c)
+    {
+        return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+    }
+
+    // Moves p back onto the lead byte of the UTF-8 code point it falls in.
+    inline const char *AlignUtf8(const char *lo, const char *p)
+    {
+        for (int i = 0; i < 3 && p > lo && IsContinuation(*p); ++i)
+            --p;
+        return p;
+    }
+
+    // End of the best chunk starting at lo whose end is at most hi: after the last paragraph
+    // break, else sentence end or line break, else whitespace, else a code point boundary.
+    // Higher-level cuts are only taken if they keep the chunk at least min_end long.
+    const char *FindCut(const char *lo, const char *hi, const char *min_end)
+    {
+        // Paragraph: "\n\n" (possibly "\n\r\n")
+        for (const char *p = hi; (p = FindLastOf<'\n'>(min_end, p)) != nullptr;)
+        {
+            const char *q = p;
+            if (q > lo && q[-1] == '\r')
+                --q;
+            if (q > lo && q[-1] == '\n')
+                return q - 1;
+        }
+        // Sentence end (punctuation followed by whitespace) or line break
+        for (const char *p = hi; (p = FindLastOf<'.', '!', '?', '\n'>(min_end, p)) != nullptr;)
+        {
+            if (*p == '\n')
+                return p;
+            if (p + 1 < hi && IsSpace(p[1]))
+                return p + 1;
+        }
+        // Word boundary
+        if (const char *p = FindLastOf<' ', '\t', '\n', '\r'>(min_end, hi))
+            return p;
+        // Never split a UTF-8 code point
+        const char *p = AlignUtf8(lo, hi);
+        return p > lo ? p : hi;
+    }
+}
+
+std::vector<Chunk::ChunkSpan> Chunk::SplitTextRecursiveSpans(std::string_view input, const int overlap, const int chunk_size)
+{
+    if (chunk_size <= 0 || overlap < 0 || overlap >= chunk_size)
+        throw std::invalid_argument("The overlap value must be smaller than the chunk size.");
+
+    const char *const begin = input.data();
+    const char *const end = begin + input.size();
+    const size_t size = size_t(chunk_size);
+    const size_t min_fill = std::max<size_t>(size / 2, 1);
+
+    std::vector<ChunkSpan> spans;
+    spans.reserve(input.size() / (size - size_t(overlap)) + 1);
+
+    const char *start = begin;
+    while (start < end && IsSpace(*start))
+        ++start;
+    while (start < end)
+    {
+        const char *cut = end;
+        if (size_t(end - start) > size)
+            cut = FindCut(start, start + size, start + min_fill);
+
+        const char *stop = cut;
+        while (stop > start && IsSpace(stop[-1]))
+            --stop;
+        if (stop > start)
+            spans.emplace_back(size_t(start - begin), size_t(stop - start));
+        if (cut == end)
+            break;
+
+        // The next chunk repeats up to `overlap` bytes, starting on a word (or at least code point)
+        // boundary at or after cut - overlap, so every chunk advances by its length minus overlap.
+        // A chunk no longer than the overlap is not repeated.
+        const char *next = cut;
+        if (overlap > 0 && cut - start > overlap)
+        {
+            const char *back = cut - overlap;
+            const char *word = back;
+            while (word < cut && !IsSpace(word[-1]))
+                ++word;
+            next = word;
+            if (next == cut)
+            {
+                next = back;
+                while (next < cut && IsContinuation(*next))
+                    ++next;
+            }
+        }
+        while (next < end && IsSpace(*next))
+            ++next;
+        start = next;
+    }
+    return spans;
+}
+
+std::vector<std::string> Chunk::SplitTextRecursive(const std::string &input, const int overlap, const int chunk_size)
+{
+    std::vector<std::string> chunks;
+    for (const auto &[offset, length] : SplitTextRecursiveSpans(input, overlap, chunk_size))
+        chunks.emplace_back(input, offset, length);
+    return chunks;
+}
@@ -0,0 +1,266 @@
+#include "Reduction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <omp.h>
+
+namespace
+{
+    constexpr size_t kOversampling = 16;
+
+    float Dot(const float *a, const float *b, size_t n)
+    {
+        float acc = 0.0f;
+#pragma omp simd reduction(+ : acc)
+        for (size_t i = 0; i < n; ++i)
+        {
+            acc += a[i] * b[i];
+        }
+        return acc;
+    }
+
+    void NormalizeRow(float *row, size_t n)
+    {
+        const float norm = std::sqrt(Dot(row, row, n));
+        if (norm == 0.0f)
+            return;
+        const float inv = 1.0f / norm;
+#pragma omp simd
+        for (size_t i = 0; i < n; ++i)
+        {
+            row[i] *= inv;
+        }
+    }
+
+    // Modified Gram-Schmidt over the rows of a [k x n] matrix.
+    void Orthonormalize(std::vector<float> &basis, size_t k, size_t n)
+    {
+        for (size_t j = 0; j < k; ++j)
+        {
+            float *qj = basis.data() + j * n;
+            for (size_t i = 0; i < j; ++i)
+            {
+                const float *qi = basis.data() + i * n;
+                const float proj = Dot(qi, qj, n);
+#pragma omp simd
+                for (size_t t = 0; t < n; ++t)
+                {
+                    qj[t] -= proj * qi[t];
+                }
+            }
+            NormalizeRow(qj, n);
+        }
+    }
+
+    // out[j] = cov · basis[j] for every row j of the [k x n] basis (cov is symmetric [n x n]).
+    void MultiplyCovariance(const std::vector<float> &cov, const std::vector<float> &basis, size_t k, size_t n, std::vector<float> &out)
+    {
+        out.resize(k * n);
+#pragma omp parallel for collapse(2) schedule(static)
+        for (size_t j = 0; j < k; ++j)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[j * n + i] = Dot(cov.data() + i * n, basis.data() + j * n, n);
+            }
+        }
+    }
+
+    // Cyclic Jacobi eigen-decomposition of a small symmetric matrix; eigenvectors are the columns of vecs.
+    void JacobiEigen(std::vector<double> &a, size_t n, std::vector<double> &values, std::vector<double> &vecs)
+    {
+        vecs.assign(n * n, 0.0);
+        for (size_t i = 0; i < n; ++i)
+            vecs[i * n + i] = 1.0;
+
+        for (int sweep = 0; sweep < 64; ++sweep)
+        {
+            double off = 0.0;
+            for (size_t p = 0; p < n; ++p)
+                for (size_t q = p + 1; q < n; ++q)
+                    off += a[p * n + q] * a[p * n + q];
+            if (off < 1e-18)
+                break;
+
+            for (size_t p = 0; p < n; ++p)
+            {
+                for (size_t q = p + 1; q < n; ++q)
+                {
+                    const double apq = a[p * n + q];
+                    if (std::abs(apq) < 1e-30)
+                        continue;
+                    const double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+                    const double t = (theta >= 0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                    const double c = 1.0 / std::sqrt(t * t + 1.0);
+                    const double s = t * c;
+                    for (size_t r = 0; r < n; ++r)
+                    {
+                        const double arp = a[r * n + p], arq = a[r * n + q];
+                        a[r * n + p] = c * arp - s * arq;
+                        a[r * n + q] = s * arp + c * arq;
+                    }
+                    for (size_t r = 0; r < n; ++r)
+                    {
+                        const double apr = a[p * n + r], aqr = a[q * n + r];
+                        a[p * n + r] = c * apr - s * aqr;
+                        a[q * n + r] = s * apr + c * aqr;
+                    }
+                    for (size_t r = 0; r < n; ++r)
+                    {
+                        const double vrp = vecs[r * n + p], vrq = vecs[r * n + q];
+                        vecs[r * n + p] = c * vrp - s * vrq;
+                        vecs[r * n + q] = s * vrp + c * vrq;
+                    }
+                }
+            }
+        }
+
+        values.resize(n);
+        for (size_t i = 0; i < n; ++i)
+            values[i] = a[i * n + i];
+    }
+}
+
+namespace Chunk
+{
+    PCAModel FitPCA(const float *rows, size_t n, size_t dim, size_t k, size_t sample, size_t iterations)
+    {
+        if (n < 2 || dim == 0)
+            throw std::invalid_argument("PCA needs at least two rows.");
+        if (k == 0 || k >= dim)
+            throw std::invalid_argument("PCA target dimension must be in [1, " + std::to_string(dim - 1) + "].");
+
+        // Evenly spaced sample, stored transposed so each feature is one contiguous column
+        const size_t s = std::clamp<size_t>(sample, 2, n);
+        std::vector<float> xt(dim * s);
+#pragma omp parallel for schedule(static)
+        for (size_t r = 0; r < s; ++r)
+        {
+            const float *row = rows + (r * n / s) * dim;
+            for (size_t c = 0; c < dim; ++c)
+            {
+                xt[c * s + r] = row[c];
+            }
+        }
+
+        PCAModel pca;
+        pca.source_dim = dim;
+        pca.dim = k;
+        pca.mean.resize(dim);
+#pragma omp parallel for schedule(static)
+        for (size_t c = 0; c < dim; ++c)
+        {
+            float *col = xt.data() + c * s;
+            const double mean = std::accumulate(col, col + s, 0.0) / double(s);
+            pca.mean[c] = float(mean);
+            for (size_t r = 0; r < s; ++r)
+            {
+                col[r] -= float(mean);
+            }
+        }
+
+        // Covariance: one dot product per (i, j >= i), mirrored
+        std::vector<float> cov(dim * dim);
+        const float scale = 1.0f / float(s - 1);
+#pragma omp parallel for schedule(dynamic, 8)
+        for (size_t i = 0; i < dim; ++i)
+        {
+            for (size_t j = i; j < dim; ++j)
+            {
+                const float v = Dot(xt.data() + i * s, xt.data() + j * s, s) * scale;
+                cov[i * dim + j] = v;
+                cov[j * dim + i] = v;
+            }
+        }
+        xt = {};
+
+        // Subspace iteration with oversampling; Rayleigh-Ritz picks and orders the top k
+        const size_t m = std::min(k + kOversampling, dim);
+        std::vector<float> basis(m * dim), product;
+        std::mt19937 rng(42);
+        std::normal_distribution<float> gauss(0.0f, 1.0f);
+        for (float &v : basis)
+            v = gauss(rng);
+        Orthonormalize(basis, m, dim);
+        for (size_t it = 0; it < iterations; ++it)
+        {
+            MultiplyCovariance(cov, basis, m, dim, product);
+            basis.swap(product);
+            Orthonormalize(basis, m, dim);
+        }
+
+        MultiplyCovariance(cov, basis, m, dim, product);
+        std::vector<double> small(m * m);
+        for (size_t a = 0; a < m; ++a)
+            for (size_t b = 0; b < m; ++b)
+                small[a * m + b] = 0.5 * (double(Dot(basis.data() + a * dim, product.data() + b * dim, dim)) +
+                                          double(Dot(basis.data() + b * dim, product.data() + a * dim, dim)));
+        std::vector<double> values, vecs;
+        JacobiEigen(small, m, values, vecs);
+
+        std::vector<size_t> order(m);
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                  { return values[a] > values[b]; });
+
+        pca.components.assign(k * dim, 0.0f);
+#pragma omp parallel for schedule(static)
+        for (size_t r = 0; r < k; ++r)
+        {
+            float *out = pca.components.data() + r * dim;
+            for (size_t a = 0; a < m; ++a)
+            {
+                const float w = float(vecs[a * m + order[r]]);
+                const float *q = basis.data() + a * dim;
+#pragma omp simd
+                for (size_t c = 0; c < dim; ++c)
+                {
+                    out[c] += w * q[c];
+                }
+            }
+            NormalizeRow(out, dim);
+        }
+        return pca;
+    }
+
+    void ApplyPCA(const PCAModel &pca, const float *rows, size_t n, float *out)
+    {
+        const size_t dim = pca.source_dim;
+#pragma omp parallel
+        {
+            std::vector<float> centered(dim);
+#pragma omp for schedule(static)
+            for (size_t i = 0; i < n; ++i)
+            {
+                const float *row = rows + i * dim;
+#pragma omp simd
+                for (size_t c = 0; c < dim; ++c)
+                {
+                    centered[c] = row[c] - pca.mean[c];
+                }
+                float *dst = out + i * pca.dim;
+                for (size_t r = 0; r < pca.dim; ++r)
+                {
+                    dst[r] = Dot(pca.components.data() + r * dim, centered.data(), dim);
+                }
+                NormalizeRow(dst, pca.dim);
+            }
+        }
+    }
+
+    void TruncateNormalize(const float *rows, size_t n, size_t dim, size_t k, float *out)
+    {
+        if (k == 0 || k > dim)
+            throw std::invalid_argument("Truncation dimension must be in [1, " + std::to_string(dim) + "].");
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; ++i)
+        {
+            float *dst = out + i * k;
+            std::copy_n(rows + i * dim, k, dst);
+            NormalizeRow(dst, k);
+        }
+    }
+}
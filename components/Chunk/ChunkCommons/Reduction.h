@@ -0,0 +1,26 @@
+#ifndef CHUNK_REDUCTION_H
+#define CHUNK_REDUCTION_H
+
+#include <cstddef>
+#include <vector>
+
+namespace Chunk
+{
+    struct PCAModel
+    {
+        size_t source_dim = 0;
+        size_t dim = 0;
+        std::vector<float> mean;       // [source_dim]
+        std::vector<float> components; // [dim x source_dim], principal axes by decreasing variance
+    };
+
+    // Fits the top-k principal axes of a row-major [n x dim] matrix on up to `sample`
+    // evenly spaced rows (covariance and subspace iteration run in parallel).
+    PCAModel FitPCA(const float *rows, size_t n, size_t dim, size_t k, size_t sample = 4096, size_t iterations = 12);
+    // out[n x pca.dim] = L2-normalized (row - mean) · components^T
+    void ApplyPCA(const PCAModel &pca, const float *rows, size_t n, float *out);
+    // Matryoshka truncation: out[n x k] = L2-normalized first k values of each row
+    void TruncateNormalize(const float *rows, size_t n, size_t dim, size_t k, float *out);
+}
+
+#endif // CHUNK_REDUCTION_H
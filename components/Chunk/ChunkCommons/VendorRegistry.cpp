@@ -0,0 +1,125 @@
+#include "VendorRegistry.h"
+#include "ChunkCommons.h"
+#include "RagException.h"
+#include "Embedding/EmbeddingModel/InferencePool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <unordered_map>
+
+namespace
+{
+    std::string canonical(std::string name)
+    {
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return name;
+    }
+
+    // Short catalogue names → directory under models/ (as written by scripts/hf_extract_model.py)
+    const std::unordered_map<std::string, std::string> kLocalModels = {
+        {"bge-small", "BAAI/bge-small-en-v1.5"},
+        {"bge-large", "BAAI/bge-large-en-v1.5"},
+        {"all-minilm-l6-v2", "sentence-transformers/all-MiniLM-L6-v2"},
+    };
+
+    class OpenAIVendor : public Chunk::EmbeddingVendor
+    {
+    public:
+        void Embed(const std::vector<std::string_view> &texts, const std::string &model,
+                   Embedding::EmbeddingSink &sink, const BatchDone &onBatch) override
+        {
+            // Retries happen per batch inside the scheduler; batch sizing is left to its options.
+            // A key set on the shared scheduler (e.g. by ChunkSimilarity) stands in for the environment.
+            if (EmbeddingOpenAI::EmbeddingOpenAI::GetSchedulerOptions().apiKey.empty())
+                Chunk::InitAPIKey();
+            EmbeddingOpenAI::EmbeddingOpenAI client;
+            client.EmbedInto(texts, model, sink, 0, onBatch);
+        }
+    };
+
+    // Runs the model locally through the shared per-model InferencePool; no network round-trip per call.
+    class LocalOnnxVendor : public Chunk::EmbeddingVendor
+    {
+    public:
+        void Embed(const std::vector<std::string_view> &texts, const std::string &model,
+                   Embedding::EmbeddingSink &sink, const BatchDone &onBatch) override
+        {
+            Pool(model)->Embed(texts, sink);
+            if (onBatch)
+                onBatch(0, texts.size());
+        }
+
+    private:
+        Embedding::InferencePoolPtr Pool(const std::string &model)
+        {
+            const std::string dir = Chunk::LocalModelDir(model);
+            const std::string path = Embedding::ModelRegistry::ModelPath(dir);
+            if (!std::filesystem::exists(path) || !std::filesystem::exists(Embedding::ModelRegistry::TokenizerPath(dir)))
+                throw RAGLibrary::RagException("Local model '" + model + "' not found at " + path +
+                                               "; export it with: python scripts/hf_extract_model.py -m " + dir);
+            return Embedding::InferencePool::Shared(dir);
+        }
+    };
+}
+
+namespace Chunk
+{
+    std::string LocalModelDir(const std::string &model)
+    {
+        auto it = kLocalModels.find(canonical(model));
+        return it != kLocalModels.end() ? it->second : model;
+    }
+
+    VendorRegistry::VendorRegistry()
+    {
+        // Built-ins are registered here rather than through static AutoRegisterVendor
+        // objects, which the linker may drop from the static library.
+        m_vendors["openai"].factory = []
+        { return std::make_shared<OpenAIVendor>(); };
+        m_vendors["huggingface"].factory = []
+        { return std::make_shared<LocalOnnxVendor>(); };
+    }
+
+    VendorRegistry &VendorRegistry::Instance()
+    {
+        static VendorRegistry inst;
+        return inst;
+    }
+
+    void VendorRegistry::Register(const std::string &vendor, Factory factory, bool allow_override)
+    {
+        const std::string key = canonical(vendor);
+        std::scoped_lock lock(m_mutex);
+
+        if (!allow_override && m_vendors.contains(key))
+            throw std::invalid_argument("Vendor handler for '" + key + "' already registered.");
+
+        m_vendors[key] = Entry{std::move(factory), nullptr};
+    }
+
+    EmbeddingVendorPtr VendorRegistry::Get(const std::string &vendor)
+    {
+        const std::string key = canonical(vendor);
+        std::scoped_lock lock(m_mutex);
+
+        auto it = m_vendors.find(key);
+        if (it == m_vendors.end())
+            throw std::runtime_error("Vendor handler for '" + vendor + "' not implemented.");
+
+        if (!it->second.handler)
+            it->second.handler = it->second.factory();
+        return it->second.handler;
+    }
+
+    std::vector<std::string> VendorRegistry::List() const
+    {
+        std::scoped_lock lock(m_mutex);
+        std::vector<std::string> keys;
+        keys.reserve(m_vendors.size());
+        for (const auto &[key, _] : m_vendors)
+            keys.push_back(key);
+        return keys;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef CHUNK_VENDOR_REGISTRY_H
+#define CHUNK_VENDOR_REGISTRY_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Embedding/EmbeddingSink.h"
+
+namespace Chunk
+{
+    /**
+     * Embedding provider behind one vendor name of Chunk::EmbeddingModel.
+     * Embed() writes the embedding of texts[i] to sink.Row(i) and reports
+     * finished row ranges through onBatch so callers can persist them early.
+     */
+    class EmbeddingVendor
+    {
+    public:
+        using BatchDone = std::function<void(size_t first, size_t count)>;
+
+        virtual ~EmbeddingVendor() = default;
+        virtual void Embed(const std::vector<std::string_view> &texts, const std::string &model,
+                           Embedding::EmbeddingSink &sink, const BatchDone &onBatch) = 0;
+    };
+    using EmbeddingVendorPtr = std::shared_ptr<EmbeddingVendor>;
+
+    /**
+     * Process-wide vendor → handler map used by Chunk::EmbedInto. "openai" and
+     * "huggingface" (local ONNX) are built in; each handler is created on first
+     * use and then shared, so per-model state such as ONNX sessions stays warm.
+     */
+    class VendorRegistry
+    {
+    public:
+        using Factory = std::function<EmbeddingVendorPtr()>;
+
+        static VendorRegistry &Instance();
+
+        void Register(const std::string &vendor, Factory factory, bool allow_override = false);
+        EmbeddingVendorPtr Get(const std::string &vendor);
+        std::vector<std::string> List() const;
+
+    private:
+        VendorRegistry();
+        VendorRegistry(const VendorRegistry &) = delete;
+        VendorRegistry &operator=(const VendorRegistry &) = delete;
+
+        struct Entry
+        {
+            Factory factory;
+            EmbeddingVendorPtr handler;
+        };
+
+        mutable std::mutex m_mutex;
+        std::map<std::string, Entry> m_vendors;
+    };
+
+    // Directory under models/ of a local model name ("bge-small" → "BAAI/bge-small-en-v1.5"); other names pass through
+    std::string LocalModelDir(const std::string &model);
+
+    template <class Concrete>
+    struct AutoRegisterVendor
+    {
+        explicit AutoRegisterVendor(const std::string &vendor)
+        {
+            VendorRegistry::Instance().Register(vendor, []
+                                                { return std::make_shared<Concrete>(); });
+        }
+    };
+}
+
+#endif // CHUNK_VENDOR_REGISTRY_H
@@ -3,6 +3,8 @@
 #include "RagException.h"
 #include "StringUtils.h"
 
+#include <algorithm>
+#include <numeric>
 #include <omp.h>
 #include <syncstream>
 
@@ -12,33 +14,57 @@ ChunkCount::ChunkCount(
     const std::string &count_unit,
     const int overlap,
     const int count_threshold)
-    : m_count_unit(count_unit), m_overlap(overlap), m_count_threshold(count_threshold)
+    : m_count_unit(count_unit), m_count_units{count_unit}, m_overlap(overlap), m_count_threshold(count_threshold)
 {
     ValidateCountUnit();
-    std::string regex_ = "regex:";
-
-    bool isRegex = m_count_unit.size() > regex_.size() &&
-                   std::equal(regex_.begin(), regex_.end(), m_count_unit.begin());
+    CompileCountUnits();
+}
 
-    std::string pattern = m_count_unit;
+ChunkCount::ChunkCount(
+    const std::vector<std::string> &count_units,
+    const int overlap,
+    const int count_threshold)
+    : m_count_unit(count_units.empty() ? std::string() : count_units.front()), m_count_units(count_units), m_overlap(overlap), m_count_threshold(count_threshold)
+{
+    ValidateCountUnit();
+    CompileCountUnits();
+}
 
-    if (isRegex)
+void ChunkCount::ValidateCountUnit()
+{
+    if (m_count_units.empty() || std::any_of(m_count_units.begin(), m_count_units.end(), [](const std::string &unit)
+                                             { return unit.empty(); }))
     {
-        pattern = pattern.replace(0, regex_.size(), "");
+        throw RAGLibrary::RagException("count_unit cannot be an empty string.");
     }
-    else
+    if (m_count_threshold < 1)
     {
-        pattern = StringUtils::escapeRegex(m_count_unit);
+        throw RAGLibrary::RagException("count_threshold must be at least 1.");
     }
-
-    m_regex = std::make_shared<re2::RE2>("(" + pattern + ")");
 }
 
-void ChunkCount::ValidateCountUnit()
+void ChunkCount::CompileCountUnits()
 {
-    if (m_count_unit.empty())
+    // All units become one alternation, so a single scan finds the next occurrence of any of them.
+    // (RE2::Set only reports which patterns matched, not where, so it cannot place the cuts.)
+    const std::string regex_ = "regex:";
+    std::string pattern;
+    for (const auto &unit : m_count_units)
     {
-        throw RAGLibrary::RagException("count_unit cannot be an empty string.");
+        bool isRegex = unit.size() > regex_.size() &&
+                       std::equal(regex_.begin(), regex_.end(), unit.begin());
+
+        if (!pattern.empty())
+        {
+            pattern += "|";
+        }
+        pattern += "(?:" + (isRegex ? unit.substr(regex_.size()) : StringUtils::escapeRegex(unit)) + ")";
+    }
+
+    m_regex = std::make_shared<re2::RE2>("(" + pattern + ")");
+    if (!m_regex->ok())
+    {
+        throw RAGLibrary::RagException("Invalid count_unit: " + m_regex->error());
     }
 }
 
@@ -47,11 +73,11 @@ std::vector<RAGLibrary::Document> ChunkCount::ProcessSingleDocument(RAGLibrary::
     std::vector<RAGLibrary::Document> documents;
     try
     {
-        auto chunks = Chunk::SplitTextByCount(item.page_content, m_overlap, m_count_threshold, m_regex);
-        documents.reserve(documents.size() + chunks.size());
-        for (auto &chunk : chunks)
+        auto spans = Chunk::SplitTextByCountSpans(item.page_content, m_overlap, m_count_threshold, *m_regex);
+        documents.reserve(documents.size() + spans.size());
+        for (const auto &[offset, length] : spans)
         {
-            documents.push_back(RAGLibrary::Document(item.metadata, chunk));
+            documents.push_back(RAGLibrary::Document(item.metadata, item.page_content.substr(offset, length)));
         }
     }
     catch (const std::exception &e)
@@ -65,6 +91,10 @@ std::vector<RAGLibrary::Document> ChunkCount::ProcessSingleDocument(RAGLibrary::
 
 std::vector<RAGLibrary::Document> ChunkCount::ProcessDocuments(const std::vector<RAGLibrary::Document> &items, int max_workers)
 {
+    // Count pass, prefix sum, then each document fills its own slice: input order, no lock
+    const int n_items = int(items.size());
+    std::vector<std::vector<Chunk::ChunkSpan>> spans(n_items);
+    std::vector<size_t> offsets(n_items + 1, 0);
     std::vector<RAGLibrary::Document> documents;
     try
     {
@@ -75,19 +105,26 @@ std::vector<RAGLibrary::Document> ChunkCount::ProcessDocuments(const std::vector
         }
 
         omp_set_num_threads(max_threads);
-        #pragma omp parallel for
-        for (int i = 0; i < items.size(); i++)
+        #pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < n_items; i++)
         {
-            auto &item = items[i];
-            auto chunks = Chunk::SplitTextByCount(item.page_content, m_overlap, m_count_threshold, m_regex);
+            spans[i] = Chunk::SplitTextByCountSpans(items[i].page_content, m_overlap, m_count_threshold, *m_regex);
+            offsets[i + 1] = spans[i].size();
+        }
 
-        #pragma omp critical
+        std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+        documents.resize(offsets.back());
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < n_items; i++)
+        {
+            const auto &item = items[i];
+            auto out = documents.begin() + offsets[i];
+            for (const auto &[offset, length] : spans[i])
             {
-                documents.reserve(documents.size() + chunks.size());
-                for (auto &chunk : chunks)
-                {
-                    documents.push_back(RAGLibrary::Document(item.metadata, chunk));
-                }
+                out->metadata = item.metadata;
+                out->page_content.assign(item.page_content, offset, length);
+                ++out;
             }
         }
     }
@@ -99,3 +136,51 @@ std::vector<RAGLibrary::Document> ChunkCount::ProcessDocuments(const std::vector
 
     return documents;
 }
+
+std::vector<Chunk::ChunkView> ChunkCount::ProcessDocumentViews(std::vector<RAGLibrary::Document> items, int max_workers)
+{
+    // Each document's text is moved into one shared buffer; chunks are spans of it,
+    // written at the document's prefix-sum offset
+    const int n_items = int(items.size());
+    std::vector<Chunk::SourcePtr> sources(n_items);
+    std::vector<std::vector<Chunk::ChunkSpan>> spans(n_items);
+    std::vector<size_t> offsets(n_items + 1, 0);
+    std::vector<Chunk::ChunkView> views;
+    try
+    {
+        int max_threads = omp_get_max_threads();
+        if (max_workers > 0 && max_workers < max_threads)
+        {
+            max_threads = max_workers;
+        }
+
+        omp_set_num_threads(max_threads);
+        #pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < n_items; i++)
+        {
+            sources[i] = Chunk::MakeSource(std::move(items[i].metadata), std::move(items[i].page_content));
+            spans[i] = Chunk::SplitTextByCountSpans(sources[i]->text, m_overlap, m_count_threshold, *m_regex);
+            offsets[i + 1] = spans[i].size();
+        }
+
+        std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+        views.resize(offsets.back());
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < n_items; i++)
+        {
+            auto out = views.begin() + offsets[i];
+            for (const auto &[offset, length] : spans[i])
+            {
+                *out++ = Chunk::ChunkView{sources[i], offset, length};
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        throw;
+    }
+
+    return views;
+}
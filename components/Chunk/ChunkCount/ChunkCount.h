@@ -2,6 +2,7 @@
 #define CHUNK_COUNT_H
 
 #include "CommonStructs.h"
+#include "ChunkCommons/ChunkView.h"
 
 #include <re2/re2.h>
 #include <vector>
@@ -14,17 +15,23 @@ namespace Chunk
     public:
         ChunkCount() = default;
         ChunkCount(const std::string &count_unit, const int overlap = 600, const int count_threshold = 1);
+        // Counts occurrences of any of the units (e.g. {"regex:[.!?]\\s", "regex:\\n[-*] "}) in the same scan
+        ChunkCount(const std::vector<std::string> &count_units, const int overlap = 600, const int count_threshold = 1);
         ~ChunkCount() = default;
 
         std::vector<RAGLibrary::Document> ProcessSingleDocument(RAGLibrary::Document &item);
         std::vector<RAGLibrary::Document> ProcessDocuments(const std::vector<RAGLibrary::Document> &items, int max_workers = 4);
+        // Same chunks as (shared document buffer, offset, length) views, in document order
+        std::vector<Chunk::ChunkView> ProcessDocumentViews(std::vector<RAGLibrary::Document> items, int max_workers = 4);
 
     protected:
         void ValidateCountUnit();
+        void CompileCountUnits();
         std::vector<std::string> SplitByCount(const std::vector<std::string> &texts);
 
     private:
         std::string m_count_unit;
+        std::vector<std::string> m_count_units;
         int m_overlap;
         int m_count_threshold;
         std::shared_ptr<re2::RE2> m_regex;
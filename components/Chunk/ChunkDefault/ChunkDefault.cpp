@@ -15,27 +15,99 @@
 #include <torch/torch.h>
 #include <iomanip>    
 #include <stdexcept>
+#include <numeric>
+#include <atomic>
+#include <format>
+#include <iterator>
+#include <thread>
+#include <limits>
+#include <unordered_set>
+#include "BoundedQueue.h"
 // using namespace Chunk;
 
+namespace {
+    // Rows [first, first + count) of a row-major matrix that grows at its tail
+    class TailSink : public Embedding::EmbeddingSink {
+    public:
+        TailSink(std::vector<float>& matrix, size_t first, size_t count) : m_matrix(matrix), m_first(first), m_count(count) {}
+        float* Row(size_t index) override { return m_matrix.data() + (m_first + index) * Dim(); }
+    protected:
+        void Allocate(size_t dim) override { m_matrix.resize((m_first + m_count) * dim); }
+    private:
+        std::vector<float>& m_matrix;
+        size_t m_first;
+        size_t m_count;
+    };
+
+    void LogDedup(size_t chunks, size_t rows) {
+        const double ratio = chunks ? 100.0 * double(chunks - rows) / double(chunks) : 0.0;
+        std::cout << std::format("Dedup: {} unique of {} chunks ({:.1f}% duplicates)\n", rows, chunks, ratio);
+    }
+
+    struct EmbedBatch {
+        size_t first = 0;
+        std::vector<std::string_view> texts;
+    };
+
+    // Content hash of one document (text and metadata); only compared within the process
+    uint64_t HashDocument(const RAGLibrary::Metadata& metadata, std::string_view text) {
+        uint64_t h = std::hash<std::string_view>{}(text);
+        for (const auto& [key, value] : metadata) {
+            h ^= std::hash<std::string>{}(key) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            h ^= std::hash<std::string>{}(value) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        }
+        // splitmix64 finalizer, so per-source sums stay well spread
+        h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    // (metadata "source", content hash) per source, in order of first appearance. A source's
+    // hash is the sum of its documents' hashes, so documents appended later just add to it.
+    std::vector<std::pair<std::string, uint64_t>> HashSources(const std::vector<RAGLibrary::Document>& items, int max_workers) {
+        std::vector<uint64_t> hashes(items.size());
+        int max_threads = omp_get_max_threads();
+        if (max_workers > 0 && max_workers < max_threads)
+            max_threads = max_workers;
+#pragma omp parallel for schedule(dynamic) num_threads(max_threads)
+        for (int i = 0; i < int(items.size()); i++)
+            hashes[i] = HashDocument(items[i].metadata, items[i].page_content);
+
+        std::vector<std::pair<std::string, uint64_t>> sources;
+        std::unordered_map<std::string, size_t> index;
+        for (size_t i = 0; i < items.size(); ++i) {
+            auto it = items[i].metadata.find("source");
+            if (it == items[i].metadata.end())
+                continue;
+            auto [slot, inserted] = index.try_emplace(it->second, sources.size());
+            if (inserted)
+                sources.emplace_back(it->second, 0);
+            sources[slot->second].second += hashes[i];
+        }
+        return sources;
+    }
+}
+
 Chunk::ChunkDefault::ChunkDefault(
     const int chunk_size, 
     const int overlap, 
     std::optional<std::vector<RAGLibrary::Document>> items_opt, 
-    int max_workers): 
-    m_chunk_size(chunk_size), m_overlap(overlap)
+    int max_workers,
+    bool boundary_aware): 
+    m_chunk_size(chunk_size), m_overlap(overlap), m_boundary_aware(boundary_aware)
 {
     if (m_overlap >= m_chunk_size) {
         throw RAGLibrary::RagException("The overlap value must be smaller than the chunk size.");
     }
     if (items_opt.has_value())
-    ProcessDocuments(*items_opt, max_workers);
+    ProcessDocuments(std::move(items_opt), max_workers);
 }  
 
-const Chunk::vdb_data& Chunk::ChunkDefault::CreateEmb(std::string model){
+const Chunk::vdb_data& Chunk::ChunkDefault::CreateEmb(std::string model, bool dedup){
     // Validation of input parameters ------------------------- 
     Chunk::to_lowercase(model);
 
-    if (this->chunks.empty())
+    if (this->m_views.empty())
         throw std::invalid_argument("Empty chunks list.");
     
     std::optional<std::string> vendor_opt = resolve_vendor_from_model(model);
@@ -45,32 +117,46 @@ const Chunk::vdb_data& Chunk::ChunkDefault::CreateEmb(std::string model){
 
     if(is_this_model_used_yet(model))
         throw std::invalid_argument("There is already an element of this chunk like this.");
-    std::vector<RAGLibrary::Document> docs;
+    // Rows land directly in flatVD; no per-document copies or vectors in between
+    std::vector<std::string_view> texts;
+    texts.reserve(this->m_views.size());
+    for (const auto& view : this->m_views)
+        texts.push_back(view.Text());
 
+    Chunk::vdb_data vdb_element;
+    if (dedup) {
+        // First occurrence of each text gets the next row; chunks keep their slots via row_of
+        std::unordered_map<std::string_view, uint32_t> first_row;
+        first_row.reserve(texts.size());
+        std::vector<std::string_view> unique;
+        vdb_element.row_of.resize(texts.size());
+        for (size_t i = 0; i < texts.size(); ++i) {
+            auto [it, inserted] = first_row.try_emplace(texts[i], uint32_t(unique.size()));
+            if (inserted)
+                unique.push_back(texts[i]);
+            vdb_element.row_of[i] = it->second;
+        }
+        LogDedup(texts.size(), unique.size());
+        texts = std::move(unique);
+    }
+    Embedding::MatrixSink sink(vdb_element.flatVD, texts.size());
+    size_t hits = 0;
     try{
-        docs = Embeddings(this->chunks, model);
+        hits = EmbedInto(texts, model, sink);
     }
     catch (const std::exception& e) {
         std::cerr << "[Exception] " << e.what() << "\n";
         throw;
-    }  
-    Chunk::vdb_data vdb_element;
-    
-    vdb_element.dim = docs[0].embedding->size();
-    vdb_element.n = this->chunks.size();
-
-    vdb_element.flatVD.clear();
-    vdb_element.flatVD.reserve(vdb_element.n * vdb_element.dim);
-    for (const auto& doc : docs) {
-        if (!doc.embedding.has_value() || doc.embedding->size() != vdb_element.dim)
-            throw std::runtime_error("Missing or inconsistent embedding.");
-        vdb_element.flatVD.insert(vdb_element.flatVD.end(), doc.embedding->begin(), doc.embedding->end());
     }
+    std::cout << "Embedding cache: " << hits << " hits, " << (texts.size() - hits) << " misses\n";
+
+    vdb_element.dim = sink.Dim();
+    vdb_element.n = this->m_views.size();
 
     vdb_element.model = model;
     vdb_element.vendor = vendor_opt.value();
 
-    const size_t expected_size = vdb_element.n * vdb_element.dim;
+    const size_t expected_size = texts.size() * vdb_element.dim;
 
     
     std::cout << "Flatten vector dimensions: <" << vdb_element.flatVD.size() << ">\n";
@@ -81,7 +167,8 @@ const Chunk::vdb_data& Chunk::ChunkDefault::CreateEmb(std::string model){
         throw std::runtime_error("Flattened vector has unexpected size.");
     }
 
-    this->elements.push_back(vdb_element);
+    this->elements.push_back(std::move(vdb_element));
+    ++this->m_generation;
     const auto& last = this->elements.back();
     std::cout << "╔═════════════════════════════════════════════════════════════════════════════════════╗\n";
     std::cout << "║ ➤ Model: " << last.model << " was added to chunks                      \n";
@@ -92,16 +179,207 @@ const Chunk::vdb_data& Chunk::ChunkDefault::CreateEmb(std::string model){
     return last;
 }
 
+const Chunk::vdb_data& Chunk::ChunkDefault::ProcessAndEmbed(const std::vector<RAGLibrary::Document>& items, std::string model, int max_workers, size_t batch_size, bool dedup){
+    // Validation of input parameters ------------------------- 
+    model = Chunk::to_lowercase(model);
+    if (this->initialized_)
+        throw std::invalid_argument("Chunks list already initialized.");
+    if (items.empty())
+        throw std::invalid_argument("No documents provided in items_opt.");
+    std::optional<std::string> vendor_opt = resolve_vendor_from_model(model);
+    if(vendor_opt==std::nullopt)
+        throw std::invalid_argument("Model not supported.");
+    if(is_this_model_used_yet(model))
+        throw std::invalid_argument("There is already an element of this chunk like this.");
+    batch_size = std::max<size_t>(batch_size, 1);
+
+    Chunk::vdb_data vdb_element;
+    vdb_element.model = model;
+    vdb_element.vendor = vendor_opt.value();
+    std::vector<Chunk::ChunkView> views;
+
+    RAGLibrary::BoundedQueue<EmbedBatch> queue(4);
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    std::atomic<bool> failed{false};
+    auto fail = [&](std::exception_ptr e) {
+        {
+            std::lock_guard lock(errorMutex);
+            if (!error)
+                error = e;
+        }
+        failed = true;
+        queue.close();
+    };
+
+    // Consumer: batches arrive in row order, so each one is appended to the tail of flatVD
+    size_t hits = 0;
+    std::thread embedder([&] {
+        try {
+            while (auto batch = queue.pop()) {
+                TailSink sink(vdb_element.flatVD, batch->first, batch->texts.size());
+                hits += EmbedInto(batch->texts, model, sink);
+                if (vdb_element.dim == 0) {
+                    vdb_element.dim = sink.Dim();
+                    // Rough row estimate from the input size, to avoid regrowing a large matrix
+                    size_t bytes = 0;
+                    for (const auto& item : items)
+                        bytes += item.page_content.size();
+                    const size_t step = size_t(std::max(m_chunk_size - m_overlap, 1));
+                    vdb_element.flatVD.reserve((bytes / step + items.size()) * vdb_element.dim);
+                }
+                else if (sink.Dim() != vdb_element.dim) {
+                    throw std::runtime_error("Inconsistent embedding dimension: expected " + std::to_string(vdb_element.dim) + ", got " + std::to_string(sink.Dim()));
+                }
+            }
+        }
+        catch (...) {
+            fail(std::current_exception());
+        }
+    });
+
+    // Producers: documents are split in parallel; the ordered section hands chunks
+    // over in document order, so row i of flatVD is always views[i]. Batches reference
+    // the shared source buffers, which stay alive in `views`.
+    int max_threads = omp_get_max_threads();
+    if (max_workers > 0 && max_workers < max_threads)
+        max_threads = max_workers;
+    EmbedBatch pending;
+    std::unordered_map<std::string_view, uint32_t> first_row;
+    std::vector<uint32_t> row_of;
+#pragma omp parallel for ordered schedule(dynamic) num_threads(max_threads)
+    for (int i = 0; i < int(items.size()); i++) {
+        Chunk::SourcePtr source;
+        std::vector<Chunk::ChunkSpan> spans;
+        if (!failed) {
+            try {
+                source = Chunk::MakeSource(items[i].metadata, items[i].page_content);
+                spans = SplitSpans(source->text);
+            }
+            catch (...) {
+                fail(std::current_exception());
+            }
+        }
+#pragma omp ordered
+        {
+            // Exceptions must not leave the structured block, and the embedder still has to be joined
+            if (!failed) {
+                try {
+                    for (const auto& [offset, length] : spans) {
+                        views.push_back(Chunk::ChunkView{source, offset, length});
+                        const std::string_view piece = views.back().Text();
+                        if (dedup) {
+                            // Only the first occurrence of a text is queued for embedding
+                            auto [it, inserted] = first_row.try_emplace(piece, uint32_t(pending.first + pending.texts.size()));
+                            row_of.push_back(it->second);
+                            if (!inserted)
+                                continue;
+                        }
+                        pending.texts.push_back(piece);
+                    }
+                    if (pending.texts.size() >= batch_size) {
+                        const size_t next = pending.first + pending.texts.size();
+                        queue.push(std::move(pending));
+                        pending = EmbedBatch{next, {}};
+                    }
+                }
+                catch (...) {
+                    fail(std::current_exception());
+                }
+            }
+        }
+    }
+    try {
+        if (!failed && !pending.texts.empty())
+            queue.push(std::move(pending));
+    }
+    catch (...) {
+        fail(std::current_exception());
+    }
+    queue.close();
+    embedder.join();
+    if (error)
+        std::rethrow_exception(error);
+    if (views.empty())
+        throw std::invalid_argument("Empty chunks list.");
+
+    vdb_element.n = views.size();
+    vdb_element.row_of = std::move(row_of);
+    const size_t rows = dedup ? first_row.size() : vdb_element.n;
+    if (vdb_element.flatVD.size() != rows * vdb_element.dim)
+        throw std::runtime_error("Flattened vector has unexpected size.");
+    if (dedup)
+        LogDedup(vdb_element.n, rows);
+    std::cout << "Embedding cache: " << hits << " hits, " << (rows - hits) << " misses\n";
+
+    this->metadata = items[0].metadata;
+    this->m_views = std::move(views);
+    this->chunks.clear();
+    this->initialized_ = true;
+    this->elements.push_back(std::move(vdb_element));
+    this->m_source_hash.clear();
+    for (const auto& [source, hash] : HashSources(items, max_workers))
+        this->m_source_hash[source] += hash;
+    ++this->m_generation;
+    const auto& last = this->elements.back();
+    LogEmbeddingStats(last.model, last.vendor, last.dim, last.n, last.flatVD.size());
+
+    return last;
+}
+
+const Chunk::vdb_data& Chunk::ChunkDefault::ReduceEmb(size_t pos, size_t dim, std::string method, size_t sample){
+    method = Chunk::to_lowercase(method);
+    if (pos >= this->elements.size())
+        throw std::out_of_range("Invalid index.");
+    if (method != "pca" && method != "matryoshka")
+        throw std::invalid_argument("Unknown reduction method '" + method + "', expected 'pca' or 'matryoshka'.");
+
+    const Chunk::vdb_data& source = this->elements[pos];
+    if (!source.reduction.empty())
+        throw std::invalid_argument("Element " + std::to_string(pos) + " is already reduced; reduce the original embeddings instead.");
+    if (dim == 0 || dim >= source.dim)
+        throw std::invalid_argument("Target dimension must be in [1, " + std::to_string(source.dim - 1) + "].");
+    for (const auto& element : this->elements) {
+        if (element.model == source.model && element.reduction == method && element.dim == dim)
+            throw std::invalid_argument("There is already an element of this chunk like this.");
+    }
+
+    Chunk::vdb_data reduced;
+    reduced.vendor = source.vendor;
+    reduced.model = source.model;
+    reduced.reduction = method;
+    reduced.source_dim = source.dim;
+    reduced.dim = dim;
+    reduced.n = source.n;
+    reduced.row_of = source.row_of;
+    const size_t rows = source.getRowCount();
+    reduced.flatVD.resize(rows * dim);
+    if (method == "pca") {
+        reduced.pca = Chunk::FitPCA(source.flatVD.data(), rows, source.dim, dim, sample);
+        Chunk::ApplyPCA(reduced.pca, source.flatVD.data(), rows, reduced.flatVD.data());
+    } else {
+        Chunk::TruncateNormalize(source.flatVD.data(), rows, source.dim, dim, reduced.flatVD.data());
+    }
+
+    this->elements.push_back(std::move(reduced));
+    ++this->m_generation;
+    const auto& last = this->elements.back();
+    std::cout << "Reduced " << last.model << " from " << last.source_dim << " to " << last.dim << " dimensions (" << last.reduction << ")\n";
+    LogEmbeddingStats(last.model, last.vendor, last.dim, last.n, last.flatVD.size());
+
+    return last;
+}
+
 std::vector<RAGLibrary::Document> Chunk::ChunkDefault::ProcessSingleDocument(RAGLibrary::Document &item)
 {
     std::vector<RAGLibrary::Document> documents;
     try
     {
-        auto chunks = Chunk::SplitText(item.page_content, m_overlap, m_chunk_size);
-        documents.reserve(documents.size() + chunks.size());
-        for (auto &chunk : chunks)
+        auto spans = SplitSpans(item.page_content);
+        documents.reserve(documents.size() + spans.size());
+        for (const auto &[offset, length] : spans)
         {
-            documents.push_back(RAGLibrary::Document(item.metadata, chunk));
+            documents.push_back(RAGLibrary::Document(item.metadata, item.page_content.substr(offset, length)));
         }
     }
     catch (const std::exception &e)
@@ -113,21 +391,17 @@ std::vector<RAGLibrary::Document> Chunk::ChunkDefault::ProcessSingleDocument(RAG
     return documents;
 }
 
-const std::vector<RAGLibrary::Document>& Chunk::ChunkDefault::ProcessDocuments(std::optional<std::vector<RAGLibrary::Document>> items_opt, int max_workers)
-{   
-    if (this->initialized_)
-        throw std::invalid_argument("Chunks list already initialized.");
-
-    
-    if (!items_opt.has_value() || items_opt->empty()) {
-        throw std::invalid_argument("No documents provided in items_opt.");
-    }
-    const auto& items = *items_opt;
-
-    this->metadata = items[0].metadata;
+std::vector<Chunk::ChunkView> Chunk::ChunkDefault::SplitDocuments(std::vector<RAGLibrary::Document>& items, int max_workers) const
+{
+    // Each document's text is moved into one shared buffer; its chunks are only spans of it.
+    // Pass 1 splits every document, pass 2 writes its views at the prefix-sum offset of the
+    // document, so the order is the input order without locks or a final concatenation.
+    const int n_items = int(items.size());
+    std::vector<Chunk::SourcePtr> sources(n_items);
+    std::vector<std::vector<Chunk::ChunkSpan>> spans(n_items);
+    std::vector<size_t> offsets(n_items + 1, 0);
+    std::vector<Chunk::ChunkView> views;
 
-    std::vector<RAGLibrary::Document> documents;
-    
     try
     {
         int max_threads = omp_get_max_threads();
@@ -137,20 +411,24 @@ const std::vector<RAGLibrary::Document>& Chunk::ChunkDefault::ProcessDocuments(s
         }
 
         omp_set_num_threads(max_threads);
-#pragma omp parallel for
-        for (int i = 0; i < items.size(); i++)
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < n_items; i++)
         {
             auto &item = items[i];
-            auto chunks = Chunk::SplitText(item.page_content, m_overlap, m_chunk_size);
-
-#pragma omp critical
-            {
-                documents.reserve(documents.size() + chunks.size());
-                for (auto &chunk : chunks)
-                {
-                    documents.push_back(RAGLibrary::Document({}, chunk));
-                }
-            }
+            sources[i] = Chunk::MakeSource(std::move(item.metadata), std::move(item.page_content));
+            spans[i] = SplitSpans(sources[i]->text);
+            offsets[i + 1] = spans[i].size();
+        }
+
+        std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+        views.resize(offsets.back());
+
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < n_items; i++)
+        {
+            auto out = views.begin() + offsets[i];
+            for (const auto &[offset, length] : spans[i])
+                *out++ = Chunk::ChunkView{sources[i], offset, length};
         }
     }
     catch (const std::exception &e)
@@ -159,11 +437,387 @@ const std::vector<RAGLibrary::Document>& Chunk::ChunkDefault::ProcessDocuments(s
         throw;
     }
 
+    return views;
+}
+
+const std::vector<Chunk::ChunkView>& Chunk::ChunkDefault::ProcessDocuments(std::optional<std::vector<RAGLibrary::Document>> items_opt, int max_workers)
+{   
+    if (this->initialized_)
+        throw std::invalid_argument("Chunks list already initialized.");
+
+    
+    if (!items_opt.has_value() || items_opt->empty()) {
+        throw std::invalid_argument("No documents provided in items_opt.");
+    }
+    auto& items = *items_opt;
+
+    this->metadata = items[0].metadata;
+
+    auto hashes = HashSources(items, max_workers);
+    auto views = SplitDocuments(items, max_workers);
+
     this->initialized_ = true;
-    this->chunks = documents;
+    this->m_views = std::move(views);
+    this->chunks.clear();
+    this->m_source_hash.clear();
+    for (const auto& [source, hash] : hashes)
+        this->m_source_hash[source] += hash;
+    ++this->m_generation;
 
-    return this->chunks;
+    return this->m_views;
+}
+
+const std::vector<Chunk::ChunkView>& Chunk::ChunkDefault::Append(std::vector<RAGLibrary::Document> items, int max_workers)
+{
+    if (items.empty())
+        throw std::invalid_argument("No documents provided.");
+    if (!this->initialized_)
+        return ProcessDocuments(std::move(items), max_workers);
+
+    auto hashes = HashSources(items, max_workers);
+    auto views = SplitDocuments(items, max_workers);
+    auto track_sources = [&] {
+        for (const auto& [source, hash] : hashes)
+            this->m_source_hash[source] += hash;
+    };
+    if (views.empty()) {
+        track_sources();
+        return this->m_views;
+    }
+    const size_t first = this->m_views.size();
+    const size_t count = views.size();
+
+    // Everything that can fail (provider calls, partition lookups) happens before any member
+    // changes, so a failed Append leaves the chunks and every element as they were.
+    std::vector<std::string> partition_values;
+    if (!m_partition_key.empty()) {
+        partition_values.reserve(count);
+        for (size_t k = 0; k < count; ++k) {
+            const auto& chunk_metadata = views[k].GetMetadata();
+            auto it = chunk_metadata.find(m_partition_key);
+            if (it == chunk_metadata.end())
+                throw std::invalid_argument("Chunk " + std::to_string(first + k) + " has no metadata field '" + m_partition_key + "'.");
+            partition_values.push_back(it->second);
+        }
+    }
+
+    struct Growth {
+        std::vector<float> rows;     // new rows, [count or new unique texts, dim]
+        std::vector<uint32_t> row_of; // new entries of row_of (deduplicated elements)
+    };
+    std::vector<Growth> growth(this->elements.size());
+    for (size_t e = 0; e < this->elements.size(); ++e) {
+        const auto& element = this->elements[e];
+        if (!element.reduction.empty())
+            continue;
+
+        std::vector<std::string_view> texts;
+        texts.reserve(count);
+        if (element.row_of.empty()) {
+            for (const auto& view : views)
+                texts.push_back(view.Text());
+        } else {
+            // Texts already embedded keep their row; only unseen ones get a new row
+            std::unordered_map<std::string_view, uint32_t> known;
+            known.reserve(element.getRowCount() + count);
+            for (size_t i = 0; i < first; ++i)
+                known.try_emplace(this->m_views[i].Text(), element.row_of[i]);
+            uint32_t next_row = uint32_t(element.getRowCount());
+            growth[e].row_of.reserve(count);
+            for (const auto& view : views) {
+                auto [it, inserted] = known.try_emplace(view.Text(), next_row);
+                if (inserted) {
+                    texts.push_back(view.Text());
+                    ++next_row;
+                }
+                growth[e].row_of.push_back(it->second);
+            }
+        }
+        if (texts.empty())
+            continue;
+
+        Embedding::MatrixSink sink(growth[e].rows, texts.size());
+        const size_t hits = EmbedInto(texts, element.model, sink);
+        if (sink.Dim() != element.dim)
+            throw std::runtime_error("Inconsistent embedding dimension: expected " + std::to_string(element.dim) + ", got " + std::to_string(sink.Dim()));
+        std::cout << "Append " << element.model << ": " << texts.size() << " rows embedded (" << hits << " cache hits)\n";
+    }
+
+    // Commit: rows go to the tail of each flatVD, growing capacity geometrically
+    auto append_rows = [](std::vector<float>& matrix, const float* rows, size_t n_floats) {
+        const size_t needed = matrix.size() + n_floats;
+        if (needed > matrix.capacity())
+            matrix.reserve(std::max(needed, matrix.capacity() * 2));
+        matrix.insert(matrix.end(), rows, rows + n_floats);
+    };
+    for (size_t e = 0; e < this->elements.size(); ++e) {
+        auto& element = this->elements[e];
+        if (!element.reduction.empty())
+            continue;
+        append_rows(element.flatVD, growth[e].rows.data(), growth[e].rows.size());
+        element.row_of.insert(element.row_of.end(), growth[e].row_of.begin(), growth[e].row_of.end());
+        element.n += count;
+    }
+    // Reduced elements project the new rows of their source with the already fitted model
+    for (auto& element : this->elements) {
+        if (element.reduction.empty())
+            continue;
+        auto source = std::find_if(this->elements.begin(), this->elements.end(), [&](const Chunk::vdb_data& candidate) {
+            return candidate.reduction.empty() && candidate.model == element.model && candidate.dim == element.source_dim;
+        });
+        if (source == this->elements.end())
+            throw std::runtime_error("Source element of reduced " + element.model + " not found.");
+        const size_t old_rows = element.getRowCount();
+        const size_t new_rows = source->getRowCount() - old_rows;
+        std::vector<float> projected(new_rows * element.dim);
+        if (element.reduction == "pca")
+            Chunk::ApplyPCA(element.pca, source->flatVD.data() + old_rows * source->dim, new_rows, projected.data());
+        else
+            Chunk::TruncateNormalize(source->flatVD.data() + old_rows * source->dim, new_rows, source->dim, element.dim, projected.data());
+        append_rows(element.flatVD, projected.data(), projected.size());
+        element.row_of = source->row_of;
+        element.n = source->n;
+    }
+
+    this->m_views.insert(this->m_views.end(), std::make_move_iterator(views.begin()), std::make_move_iterator(views.end()));
+    for (size_t k = 0; k < partition_values.size(); ++k)
+        m_partitions[partition_values[k]].push_back(first + k);
+    track_sources();
+    ++this->m_generation;
+
+    return this->m_views;
 }
+
+const std::vector<Chunk::ChunkView>& Chunk::ChunkDefault::Reingest(std::vector<RAGLibrary::Document> items, bool remove_missing, int max_workers)
+{
+    if (items.empty())
+        throw std::invalid_argument("No documents provided.");
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (!items[i].metadata.contains("source"))
+            throw std::invalid_argument("Document " + std::to_string(i) + " has no metadata field 'source'.");
+    }
+    if (!this->initialized_)
+        return ProcessDocuments(std::move(items), max_workers);
+
+    // Sources whose content hash is new or different are re-chunked; the rest keep their chunks
+    const auto hashes = HashSources(items, max_workers);
+    std::unordered_map<std::string, uint64_t> changed;
+    for (const auto& [source, hash] : hashes) {
+        auto it = m_source_hash.find(source);
+        if (it == m_source_hash.end() || it->second != hash)
+            changed.emplace(source, hash);
+    }
+    std::unordered_set<std::string> removed;
+    if (remove_missing) {
+        std::unordered_set<std::string> incoming;
+        for (const auto& [source, _] : hashes)
+            incoming.insert(source);
+        for (const auto& [source, _] : m_source_hash)
+            if (!incoming.contains(source))
+                removed.insert(source);
+    }
+    if (changed.empty() && removed.empty()) {
+        std::cout << std::format("Reingest: {} sources unchanged\n", hashes.size());
+        return this->m_views;
+    }
+
+    std::vector<RAGLibrary::Document> changed_items;
+    for (auto& item : items)
+        if (changed.contains(item.metadata.at("source")))
+            changed_items.push_back(std::move(item));
+    const auto fresh = SplitDocuments(changed_items, max_workers);
+
+    std::unordered_map<std::string, std::vector<size_t>> fresh_of;
+    std::vector<std::string> fresh_order;
+    for (size_t k = 0; k < fresh.size(); ++k) {
+        const std::string& source = fresh[k].GetMetadata().at("source");
+        auto [it, inserted] = fresh_of.try_emplace(source);
+        if (inserted)
+            fresh_order.push_back(source);
+        it->second.push_back(k);
+    }
+
+    // New chunk list: unchanged chunks keep their place, the new chunks of a changed source
+    // replace its old block, new sources go last. origin[j] is the old index of a kept chunk.
+    constexpr size_t kFresh = std::numeric_limits<size_t>::max();
+    std::vector<Chunk::ChunkView> views;
+    std::vector<size_t> origin;
+    views.reserve(this->m_views.size() + fresh.size());
+    origin.reserve(this->m_views.size() + fresh.size());
+    std::unordered_set<std::string> placed;
+    auto place = [&](const std::string& source) {
+        if (!placed.insert(source).second)
+            return;
+        auto it = fresh_of.find(source);
+        if (it == fresh_of.end())
+            return;
+        for (size_t k : it->second) {
+            views.push_back(fresh[k]);
+            origin.push_back(kFresh);
+        }
+    };
+    for (size_t i = 0; i < this->m_views.size(); ++i) {
+        const auto& chunk_metadata = this->m_views[i].GetMetadata();
+        auto it = chunk_metadata.find("source");
+        if (it != chunk_metadata.end()) {
+            if (removed.contains(it->second))
+                continue;
+            if (changed.contains(it->second)) {
+                place(it->second);
+                continue;
+            }
+        }
+        views.push_back(this->m_views[i]);
+        origin.push_back(i);
+    }
+    for (const auto& source : fresh_order)
+        place(source);
+
+    // A new chunk whose text already existed (e.g. an untouched paragraph of an edited file)
+    // reuses that chunk's row instead of being embedded again
+    std::unordered_map<std::string_view, size_t> old_chunk_of;
+    for (const auto& view : fresh)
+        old_chunk_of.try_emplace(view.Text(), kFresh);
+    for (size_t i = 0; i < this->m_views.size(); ++i) {
+        auto it = old_chunk_of.find(this->m_views[i].Text());
+        if (it != old_chunk_of.end() && it->second == kFresh)
+            it->second = i;
+    }
+
+    // Everything is built aside and only swapped in at the end, so a failed embedding call
+    // leaves the chunks and elements as they were
+    struct Rebuilt {
+        std::vector<float> flatVD;
+        std::vector<uint32_t> row_of;
+        std::vector<size_t> row_old; // old row each new row is copied from, or kFresh
+    };
+    std::vector<Rebuilt> rebuilt(this->elements.size());
+    size_t embedded_total = 0;
+    for (size_t e = 0; e < this->elements.size(); ++e) {
+        const auto& element = this->elements[e];
+        if (!element.reduction.empty())
+            continue;
+        auto& out = rebuilt[e];
+        const bool dedup = !element.row_of.empty();
+        const size_t dim = element.dim;
+
+        std::vector<std::string_view> to_embed;
+        std::unordered_map<std::string_view, size_t> embed_slot;
+        std::vector<size_t> row_slot;
+        std::unordered_map<std::string_view, uint32_t> row_of_text;
+        auto add_row = [&](size_t old_chunk, std::string_view text) {
+            if (old_chunk != kFresh) {
+                out.row_old.push_back(dedup ? element.row_of[old_chunk] : old_chunk);
+                row_slot.push_back(0);
+                return;
+            }
+            auto [it, inserted] = embed_slot.try_emplace(text, to_embed.size());
+            if (inserted)
+                to_embed.push_back(text);
+            out.row_old.push_back(kFresh);
+            row_slot.push_back(it->second);
+        };
+        for (size_t j = 0; j < views.size(); ++j) {
+            const std::string_view text = views[j].Text();
+            const size_t old_chunk = origin[j] != kFresh ? origin[j] : old_chunk_of.at(text);
+            if (dedup) {
+                auto [it, inserted] = row_of_text.try_emplace(text, uint32_t(out.row_old.size()));
+                if (inserted)
+                    add_row(old_chunk, text);
+                out.row_of.push_back(it->second);
+            } else {
+                add_row(old_chunk, text);
+            }
+        }
+
+        std::vector<float> embedded;
+        if (!to_embed.empty()) {
+            Embedding::MatrixSink sink(embedded, to_embed.size());
+            EmbedInto(to_embed, element.model, sink);
+            if (sink.Dim() != dim)
+                throw std::runtime_error("Inconsistent embedding dimension: expected " + std::to_string(dim) + ", got " + std::to_string(sink.Dim()));
+        }
+        embedded_total += to_embed.size();
+
+        const size_t rows = out.row_old.size();
+        out.flatVD.resize(rows * dim);
+#pragma omp parallel for schedule(static)
+        for (long long r = 0; r < (long long)rows; ++r) {
+            const float* src = out.row_old[r] != kFresh ? element.flatVD.data() + out.row_old[r] * dim
+                                                        : embedded.data() + row_slot[r] * dim;
+            std::memcpy(out.flatVD.data() + size_t(r) * dim, src, dim * sizeof(float));
+        }
+        std::cout << std::format("Reingest {}: {} of {} rows embedded\n", element.model, to_embed.size(), rows);
+    }
+
+    // Reduced elements copy their kept rows and project only the re-embedded ones
+    for (size_t e = 0; e < this->elements.size(); ++e) {
+        const auto& element = this->elements[e];
+        if (element.reduction.empty())
+            continue;
+        size_t s = 0;
+        while (s < this->elements.size() && !(this->elements[s].reduction.empty() && this->elements[s].model == element.model && this->elements[s].dim == element.source_dim))
+            ++s;
+        if (s == this->elements.size())
+            throw std::runtime_error("Source element of reduced " + element.model + " not found.");
+        const auto& source = rebuilt[s];
+        auto& out = rebuilt[e];
+        const size_t rows = source.row_old.size();
+        out.row_of = source.row_of;
+        out.flatVD.resize(rows * element.dim);
+
+        std::vector<size_t> fresh_rows;
+        for (size_t r = 0; r < rows; ++r) {
+            if (source.row_old[r] != kFresh)
+                std::memcpy(out.flatVD.data() + r * element.dim, element.flatVD.data() + source.row_old[r] * element.dim, element.dim * sizeof(float));
+            else
+                fresh_rows.push_back(r);
+        }
+        std::vector<float> input(fresh_rows.size() * element.source_dim);
+        for (size_t k = 0; k < fresh_rows.size(); ++k)
+            std::memcpy(input.data() + k * element.source_dim, source.flatVD.data() + fresh_rows[k] * element.source_dim, element.source_dim * sizeof(float));
+        std::vector<float> projected(fresh_rows.size() * element.dim);
+        if (element.reduction == "pca")
+            Chunk::ApplyPCA(element.pca, input.data(), fresh_rows.size(), projected.data());
+        else
+            Chunk::TruncateNormalize(input.data(), fresh_rows.size(), element.source_dim, element.dim, projected.data());
+        for (size_t k = 0; k < fresh_rows.size(); ++k)
+            std::memcpy(out.flatVD.data() + fresh_rows[k] * element.dim, projected.data() + k * element.dim, element.dim * sizeof(float));
+    }
+
+    std::unordered_map<std::string, std::vector<size_t>> partitions;
+    if (!m_partition_key.empty()) {
+        for (size_t i = 0; i < views.size(); ++i) {
+            const auto& chunk_metadata = views[i].GetMetadata();
+            auto it = chunk_metadata.find(m_partition_key);
+            if (it == chunk_metadata.end())
+                throw std::invalid_argument("Chunk " + std::to_string(i) + " has no metadata field '" + m_partition_key + "'.");
+            partitions[it->second].push_back(i);
+        }
+    }
+
+    // Commit
+    const size_t kept = views.size() - size_t(std::count(origin.begin(), origin.end(), kFresh));
+    for (size_t e = 0; e < this->elements.size(); ++e) {
+        auto& element = this->elements[e];
+        element.flatVD = std::move(rebuilt[e].flatVD);
+        element.row_of = std::move(rebuilt[e].row_of);
+        element.n = views.size();
+    }
+    this->m_views = std::move(views);
+    this->chunks.clear();
+    m_partitions = std::move(partitions);
+    for (const auto& source : removed)
+        m_source_hash.erase(source);
+    for (const auto& [source, hash] : changed)
+        m_source_hash[source] = hash;
+    ++this->m_generation;
+
+    std::cout << std::format("Reingest: {} sources changed, {} removed; {} of {} chunks kept, {} texts embedded\n",
+                             changed.size(), removed.size(), kept, this->m_views.size(), embedded_total);
+    return this->m_views;
+}
+
 void Chunk::ChunkDefault::LogEmbeddingStats(std::string model, std::string vendor , size_t dim, size_t n, size_t flatVD_size) const{
     std::cout << "╔═════════════════════════════════════════════════════════════════════════════════════╗\n";
     std::cout << "║ ➤ Model / Vendor    : " << model << " / " << vendor << "         \n";
@@ -178,7 +832,7 @@ void Chunk::ChunkDefault::printVD(void) {
         return;
     }
 
-    size_t total_chunks = chunks.size();
+    size_t total_chunks = m_views.size();
     size_t total_embeddings = this->elements.size();
 
     if (total_embeddings > 0){
@@ -194,12 +848,34 @@ void Chunk::ChunkDefault::printVD(void) {
 }
 
 const std::vector<RAGLibrary::Document>& Chunk::ChunkDefault::getChunks() const {
-    if (this->chunks.empty()) {
+    if (this->m_views.empty()) {
         throw std::runtime_error("Chunks is empty");
     }
+    std::scoped_lock lock(m_chunks_mutex);
+    if (this->chunks.size() != this->m_views.size())
+        this->chunks = Chunk::Materialize(this->m_views);
     return this->chunks;
 }
 
+const std::vector<Chunk::ChunkView>& Chunk::ChunkDefault::getChunkViews() const {
+    if (this->m_views.empty()) {
+        throw std::runtime_error("Chunks is empty");
+    }
+    return this->m_views;
+}
+
+std::shared_ptr<const Chunk::ChunkArena> Chunk::ChunkDefault::getChunkArena(int max_workers) const {
+    if (this->m_views.empty()) {
+        throw std::runtime_error("Chunks is empty");
+    }
+    std::scoped_lock lock(m_chunks_mutex);
+    if (!m_arena || m_arena_generation != m_generation) {
+        m_arena = std::make_shared<const Chunk::ChunkArena>(Chunk::BuildArena(this->m_views, max_workers));
+        m_arena_generation = m_generation;
+    }
+    return m_arena;
+}
+
 const Chunk::vdb_data* Chunk::ChunkDefault::getElement(size_t pos) const{
     if (pos < this->elements.size())
         return &this->elements[pos];
@@ -210,8 +886,51 @@ size_t Chunk::ChunkDefault::quant_of_elements(void) const {
     return this->elements.size();
 }
 
+void Chunk::ChunkDefault::PartitionBy(const std::string& field) {
+    if (field.empty())
+        throw std::invalid_argument("Partition field cannot be empty.");
+    if (this->m_views.empty())
+        throw std::invalid_argument("Empty chunks list.");
+
+    // Rows are shared by every vdb_data element, so one row-id list per
+    // partition value prunes the scan for all models at once.
+    std::unordered_map<std::string, std::vector<size_t>> partitions;
+    for (size_t i = 0; i < this->m_views.size(); ++i) {
+        const auto& chunk_metadata = this->m_views[i].GetMetadata();
+        auto it = chunk_metadata.find(field);
+        if (it == chunk_metadata.end())
+            throw std::invalid_argument("Chunk " + std::to_string(i) + " has no metadata field '" + field + "'.");
+        partitions[it->second].push_back(i);
+    }
+
+    m_partition_key = field;
+    m_partitions = std::move(partitions);
+}
+
+const std::vector<size_t>* Chunk::ChunkDefault::getPartition(const std::string& value) const {
+    auto it = m_partitions.find(value);
+    if (it == m_partitions.end())
+        return nullptr;
+    return &it->second;
+}
+
+std::vector<std::string> Chunk::ChunkDefault::listPartitions(void) const {
+    std::vector<std::string> values;
+    values.reserve(m_partitions.size());
+    for (const auto& [value, _] : m_partitions)
+        values.push_back(value);
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
 void Chunk::ChunkDefault::clear(void) {
+    m_views.clear();
     chunks.clear();
+    m_arena.reset();
     this->elements.clear();
+    m_partition_key.clear();
+    m_partitions.clear();
+    m_source_hash.clear();
     initialized_ = false;
+    ++m_generation;
 }
@@ -1,8 +1,10 @@
 #ifndef CHUNK_DEFAULT_H
 #define CHUNK_DEFAULT_H
 
+#include <limits>
 #include <regex>
 #include <vector>
+#include <mutex>
 #include <re2/re2.h>
 #include "ChunkCommons/ChunkCommons.h"
 #include "CommonStructs.h"
@@ -13,18 +15,49 @@ namespace Chunk
     {
  
     public:
-        ChunkDefault(const int chunk_size = 100, const int overlap = 20, std::optional<std::vector<RAGLibrary::Document>> items_opt = std::nullopt, int max_workers = 4);
+        // boundary_aware cuts at paragraph / sentence / word boundaries (SplitTextRecursive) instead of fixed byte offsets
+        ChunkDefault(const int chunk_size = 100, const int overlap = 20, std::optional<std::vector<RAGLibrary::Document>> items_opt = std::nullopt, int max_workers = 4, bool boundary_aware = false);
         ~ChunkDefault() = default;
-        const std::vector<RAGLibrary::Document>& ProcessDocuments(std::optional<std::vector<RAGLibrary::Document>> items_opt = std::nullopt, int max_workers = 4);
-        const Chunk::vdb_data& CreateEmb(std::string model = "text-embedding-ada-002"); 
+        const std::vector<Chunk::ChunkView>& ProcessDocuments(std::optional<std::vector<RAGLibrary::Document>> items_opt = std::nullopt, int max_workers = 4);
+        // Chunks only the new documents and embeds only their chunks for every existing element
+        // (reduced ones reuse their fitted projection). Bound ChunkQuery objects rebind on next use.
+        // Not safe to run concurrently with queries on this object.
+        const std::vector<Chunk::ChunkView>& Append(std::vector<RAGLibrary::Document> items, int max_workers = 4);
+        // Re-ingests documents keyed by metadata "source": sources whose content hash is unchanged
+        // keep their chunks and rows, changed ones are re-chunked and only chunk texts that did not
+        // exist before are embedded. remove_missing drops sources absent from items.
+        const std::vector<Chunk::ChunkView>& Reingest(std::vector<RAGLibrary::Document> items, bool remove_missing = false, int max_workers = 4);
+        // With dedup, byte-identical chunks are embedded once and share a flatVD row (vdb_data::row_of).
+        const Chunk::vdb_data& CreateEmb(std::string model = "text-embedding-ada-002", bool dedup = false); 
+        // Streaming ProcessDocuments + CreateEmb: batches of `batch_size` chunks are embedded while
+        // later documents are still being split; rows keep document order.
+        const Chunk::vdb_data& ProcessAndEmbed(const std::vector<RAGLibrary::Document>& items, std::string model = "text-embedding-ada-002", int max_workers = 4, size_t batch_size = 256, bool dedup = false);
+        // Adds a dim-dimensional copy of element `pos`: "pca" fitted on `sample` rows, or
+        // "matryoshka" truncation; both renormalized, queries are projected by ChunkQuery.
+        const Chunk::vdb_data& ReduceEmb(size_t pos, size_t dim, std::string method = "pca", size_t sample = 4096);
         void LogEmbeddingStats(std::string model, std::string vendor , size_t dim, size_t n, size_t flatVD_size) const;
         void printVD(void);
+        // Materializes the chunks as Documents on first use; prefer getChunkViews() / getChunkText().
         const std::vector<RAGLibrary::Document>& getChunks(void) const;
+        const std::vector<Chunk::ChunkView>& getChunkViews(void) const;
+        // All chunk texts in one contiguous buffer with an offsets array; built on first use.
+        // A change of the chunks builds a new arena; arenas already handed out stay valid.
+        std::shared_ptr<const Chunk::ChunkArena> getChunkArena(int max_workers = 4) const;
+        inline std::string_view getChunkText(size_t i) const {
+            return m_views.at(i).Text();
+        }
+        inline size_t quant_of_chunks(void) const {
+            return m_views.size();
+        }
         const Chunk::vdb_data* getElement(size_t pos) const;
         size_t quant_of_elements(void) const;
         inline bool isInitialized(void) const{
             return initialized_;
         }
+        // Bumped whenever chunks or elements change (rows may have moved); see ChunkQuery
+        inline size_t getGeneration(void) const {
+            return m_generation;
+        }
         inline const std::vector<float>& getFlatVD(size_t i) const {
             if (i >= elements.size())
                 throw std::out_of_range("Invalid index.");
@@ -33,22 +66,44 @@ namespace Chunk
             return elements[i].flatVD;
         }
         //--------------------------------------------
+        // Partitioning: one row-id sub-index per value of a metadata field
+        void PartitionBy(const std::string& field);
+        const std::vector<size_t>* getPartition(const std::string& value) const;
+        std::vector<std::string> listPartitions(void) const;
+        inline const std::string& getPartitionKey(void) const {
+            return m_partition_key;
+        }
+        //--------------------------------------------
         void clear(void);
         
     private:
         std::map<std::string, std::string> metadata;
-        std::vector<RAGLibrary::Document> chunks;
+        std::vector<Chunk::ChunkView> m_views;
+        mutable std::vector<RAGLibrary::Document> chunks; // built lazily by getChunks()
+        mutable std::shared_ptr<const Chunk::ChunkArena> m_arena; // built lazily by getChunkArena()
+        mutable size_t m_arena_generation = std::numeric_limits<size_t>::max();
+        mutable std::mutex m_chunks_mutex;
         std::vector<Chunk::vdb_data> elements;
         int m_chunk_size;
         int m_overlap;
+        bool m_boundary_aware = false;
         bool initialized_ = false;// Allow only one instance of the chunks list to be created
+        size_t m_generation = 0;
+        std::string m_partition_key;
+        std::unordered_map<std::string, std::vector<size_t>> m_partitions;
+        std::unordered_map<std::string, uint64_t> m_source_hash; // metadata "source" → content hash
         
         std::vector<RAGLibrary::Document> ProcessSingleDocument(RAGLibrary::Document &item);
+        std::vector<Chunk::ChunkView> SplitDocuments(std::vector<RAGLibrary::Document>& items, int max_workers) const;
+        inline std::vector<Chunk::ChunkSpan> SplitSpans(std::string_view text) const {
+            return m_boundary_aware ? Chunk::SplitTextRecursiveSpans(text, m_overlap, m_chunk_size)
+                                    : Chunk::SplitTextSpans(text, m_overlap, m_chunk_size);
+        }
         inline bool is_this_model_used_yet(const std::string& modelo_procurado) {
             return std::any_of(
                 this->elements.begin(), this->elements.end(),
                 [&](const Chunk::vdb_data& vdb) {
-                    return vdb.model == modelo_procurado;
+                    return vdb.reduction.empty() && vdb.model == modelo_procurado;
                 }
             );
         }
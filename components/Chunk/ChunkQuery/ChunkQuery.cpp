@@ -43,7 +43,72 @@ Chunk::ChunkQuery::ChunkQuery(
     }
 }
 
-void Chunk::ChunkQuery::setChunks(const Chunk::ChunkDefault& chunks, size_t pos) {
+Chunk::QueryEmbeddingCache& Chunk::QueryEmbeddingCache::Instance() {
+    static QueryEmbeddingCache inst;
+    return inst;
+}
+
+Chunk::QueryEmbeddingCache::EmbeddingPtr Chunk::QueryEmbeddingCache::Get(const std::string& model, const std::string& text) {
+    const std::string key = model + '\0' + text;
+    std::scoped_lock lock(m_mutex);
+    auto it = m_index.find(key);
+    if (it == m_index.end())
+        return nullptr;
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->second;
+}
+
+void Chunk::QueryEmbeddingCache::Put(const std::string& model, const std::string& text, EmbeddingPtr embedding) {
+    std::string key = model + '\0' + text;
+    std::scoped_lock lock(m_mutex);
+    if (m_capacity == 0)
+        return;
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        it->second->second = std::move(embedding);
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return;
+    }
+    m_lru.emplace_front(key, std::move(embedding));
+    m_index.emplace(std::move(key), m_lru.begin());
+    while (m_lru.size() > m_capacity) {
+        m_index.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+}
+
+void Chunk::QueryEmbeddingCache::SetCapacity(size_t capacity) {
+    std::scoped_lock lock(m_mutex);
+    m_capacity = capacity;
+    while (m_lru.size() > m_capacity) {
+        m_index.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+}
+
+void Chunk::QueryEmbeddingCache::Clear(void) {
+    std::scoped_lock lock(m_mutex);
+    m_lru.clear();
+    m_index.clear();
+}
+
+size_t Chunk::QueryEmbeddingCache::Size(void) const {
+    std::scoped_lock lock(m_mutex);
+    return m_lru.size();
+}
+
+std::vector<float> Chunk::ChunkQuery::EmbedQuery(const std::string& text, const std::string& model) {
+    auto& cache = QueryEmbeddingCache::Instance();
+    if (auto cached = cache.Get(model, text))
+        return *cached;
+
+    auto results = Chunk::Embeddings({ RAGLibrary::Document({}, text) }, model);
+    auto embedding = std::make_shared<const std::vector<float>>(validateEmbeddingResult(results).embedding.value());
+    cache.Put(model, text, embedding);
+    return *embedding;
+}
+
+void Chunk::ChunkQuery::BindElement(const Chunk::ChunkDefault& chunks, size_t pos) {
     if (!chunks.isInitialized())
         throw std::invalid_argument("No class.");
 
@@ -58,41 +123,36 @@ void Chunk::ChunkQuery::setChunks(const Chunk::ChunkDefault& chunks, size_t pos)
     if (!vdb)
         throw std::invalid_argument("No element in this position.");
 
-    if (m_vdb && m_vdb->model != vdb->model && !m_query.empty()) {
-        m_emb_query.clear();
-        auto docs = Chunk::Embeddings({ RAGLibrary::Document({}, m_query)}, vdb->model);
-        if (!docs[0].embedding.has_value())
-            throw std::runtime_error("Missing embedding in generated doc.");
-        m_query_doc = docs[0];
-        m_emb_query = docs[0].embedding.value();
-    }
-
     if (!m_chunk_embedding.empty()) m_chunk_embedding.clear();
     m_vdb = vdb; 
     m_chunk_embedding.reserve(m_vdb->n);
     for (size_t i = 0; i < m_vdb->n; ++i) {
-        const float* ptr = m_vdb->flatVD.data() + (i * m_vdb->dim);
+        const float* ptr = m_vdb->getRow(i); // deduplicated chunks share a row
         m_chunk_embedding.emplace_back(ptr, m_vdb->dim); 
     }
     if (m_chunk_embedding.empty()) throw std::runtime_error("Unable to create window");
     m_n_chunk =vdb->n;
     m_dim = vdb->dim;
     m_pos = pos;
-    m_chunks_list = &chunks.getChunks(); 
     m_chunks = &chunks;
+    m_generation = chunks.getGeneration();
+}
+
+void Chunk::ChunkQuery::RefreshIfStale(void) {
+    if (m_chunks != nullptr && m_chunks->getGeneration() != m_generation)
+        BindElement(*m_chunks, m_pos);
+}
+
+void Chunk::ChunkQuery::setChunks(const Chunk::ChunkDefault& chunks, size_t pos) {
+    BindElement(chunks, pos);
     m_query_doc = {};  //clear
     m_emb_query.clear();
 
-    RAGLibrary::Document result;
-    if(m_vdb!=nullptr){
-        try{
-            auto results = Chunk::Embeddings({ RAGLibrary::Document({}, m_query) }, m_vdb->model);
-            result = validateEmbeddingResult(results);
-        }
-        catch(const std::exception& e){
-            throw;
-        }
-        m_emb_query = result.embedding.value(); 
+    // Re-embed the current query for this element's model (a cache hit when only the position changed)
+    if (!m_query.empty()) {
+        RAGLibrary::Document result({}, m_query);
+        result.embedding = EmbedQuery(m_query, m_vdb->model);
+        m_emb_query = m_vdb->Project(result.embedding.value());
         m_n = 1;
         m_query_doc = result;
         m_query_doc.metadata["model"] = m_vdb->model;
@@ -103,30 +163,25 @@ RAGLibrary::Document Chunk::ChunkQuery::Query(std::string query, const Chunk::Ch
     if (query.empty() || query.size()<5) {
         throw std::invalid_argument("Query string is empty.");
     }
+    m_query = query;
     if (pos.has_value()){
         if (temp_chunks != nullptr) setChunks(*temp_chunks, pos.value());
         else if(m_chunks != nullptr) setChunks(*m_chunks, pos.value());
     }
+    RefreshIfStale();
 
     m_query_doc = {};  //clear
     m_emb_query.clear();
-    m_query = query;
-    RAGLibrary::Document result;
+    RAGLibrary::Document result({}, query);
     if(m_vdb!=nullptr){
-        try{
-            auto results = Chunk::Embeddings({ RAGLibrary::Document({}, query) }, m_vdb->model);// sempre retorna algo 
-            result =validateEmbeddingResult(results);
-        }
-        catch(const std::exception& e){
-            throw;
-        }
-        m_emb_query = result.embedding.value(); 
+        result.embedding = EmbedQuery(query, m_vdb->model);
+        m_emb_query = m_vdb->Project(result.embedding.value());
         m_n = 1;
         m_query_doc = result;
         m_query_doc.metadata["model"] = m_vdb->model;
     }
     else {
-        m_query_doc = RAGLibrary::Document({}, query);
+        m_query_doc = result;
         m_n = 0;
     }
 
@@ -144,8 +199,8 @@ RAGLibrary::Document Chunk::ChunkQuery::Query(RAGLibrary::Document query_doc, co
         if (temp_chunks != nullptr) setChunks(*temp_chunks, pos.value());
         else if(m_chunks != nullptr) setChunks(*m_chunks, pos.value());
     }
+    RefreshIfStale();
 
-    RAGLibrary::Document result;
     if(this->m_vdb!=nullptr){
         this->m_query_doc = {};  
         this->m_emb_query.clear();
@@ -157,23 +212,20 @@ RAGLibrary::Document Chunk::ChunkQuery::Query(RAGLibrary::Document query_doc, co
             wrong_model = (it->second != m_vdb->model);
         }
 
+        this->m_query_doc = query_doc;
         if (needs_embedding || wrong_model) {
-            auto results = Chunk::Embeddings({ query_doc }, m_vdb->model);
-            result = validateEmbeddingResult(results);
-            this->m_query_doc = result;
+            this->m_query_doc.embedding = EmbedQuery(query_doc.page_content, m_vdb->model);
             this->m_query_doc.metadata["model"] = m_vdb->model;
-            m_n = 1;
-        } else {
-            this->m_query_doc = query_doc;
         }
-        this->m_emb_query = this->m_query_doc.embedding.value();
-        m_n = 1;
+        // Reduced elements (PCA / Matryoshka) score in their own space
+        this->m_emb_query = m_vdb->Project(this->m_query_doc.embedding.value());
     }
     m_n = 1;
     return this->m_query_doc;
 }
-std::vector<std::tuple<std::string, float, int>> Chunk::ChunkQuery::Retrieve(float threshold, const Chunk::ChunkDefault* temp_chunks, std::optional<size_t> pos) {
+std::vector<std::tuple<std::string, float, int>> Chunk::ChunkQuery::Retrieve(float threshold, const Chunk::ChunkDefault* temp_chunks, std::optional<size_t> pos, std::optional<std::string> partition) {
     // Validation of input parameters -----------------------------------------------------------------------
+    RefreshIfStale();
     if (m_emb_query.empty()) throw std::runtime_error("Query not yet initialized.");
     if (threshold < -1.0f || threshold > 1.0f) throw std::invalid_argument("Threshold out of bound [-1,1].");
     if (m_vdb->flatVD.empty()) throw std::runtime_error("Embeddings not found.");
@@ -183,6 +235,20 @@ std::vector<std::tuple<std::string, float, int>> Chunk::ChunkQuery::Retrieve(flo
         else throw std::invalid_argument("Position was provided, but no chunk context (temp_chunks or m_chunks) was set.");
     }
 
+    // Partition pruning: only the rows of the requested partition are scanned
+    const std::vector<size_t>* rows = nullptr;
+    if (partition.has_value()) {
+        if (m_chunks == nullptr || m_chunks->getPartitionKey().empty())
+            throw std::invalid_argument("Partition was provided, but the chunks are not partitioned.");
+        rows = m_chunks->getPartition(partition.value());
+        if (rows == nullptr) {
+            m_retrieve_list.clear();
+            quant_retrieve_list = 0;
+            return m_retrieve_list;
+        }
+    }
+    const int n_rows = rows ? int(rows->size()) : int(m_chunk_embedding.size());
+
     // Temporary vector (text, score, index)
     std::vector<std::tuple<std::string, float, int>> scored_hits;
     auto query_tensor = torch::from_blob(
@@ -197,7 +263,8 @@ std::vector<std::tuple<std::string, float, int>> Chunk::ChunkQuery::Retrieve(flo
     {
         std::vector<std::tuple<std::string, float, int>> local_hits;
         #pragma omp for nowait
-        for (int i = 0; i < int(m_chunk_embedding.size()); ++i) {
+        for (int r = 0; r < n_rows; ++r) {
+            const int i = rows ? int((*rows)[r]) : r;
             auto& emb = m_chunk_embedding[i];
             auto chunk_tensor = torch::from_blob(
                 const_cast<float*>(emb.data()),
@@ -212,7 +279,7 @@ std::vector<std::tuple<std::string, float, int>> Chunk::ChunkQuery::Retrieve(flo
                 local_hits.emplace_back(
                     //const auto& doc = (*this->chunks_list)[i];
                     //std::cout << doc.page_content << std::endl;,
-                    (*this->m_chunks_list)[i].page_content,
+                    std::string(m_chunks->getChunkText(i)),
                     sim,
                     i
                 );
@@ -272,10 +339,10 @@ RAGLibrary::Document Chunk::ChunkQuery::getQuery(void) const {
 }
 
 const std::vector<RAGLibrary::Document>& Chunk::ChunkQuery::getChunksList() const {
-    if (m_chunks_list == nullptr) {
+    if (m_chunks == nullptr) {
         throw std::runtime_error("Chunks list not initialized.");
     }
-    return *m_chunks_list;
+    return m_chunks->getChunks();
 }
 
 std::string Chunk::ChunkQuery::getMod(void) const {
@@ -3,12 +3,46 @@
 #include <tuple>
 #include <string>
 #include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "CommonStructs.h"
 #include "ChunkCommons/ChunkCommons.h"
 #include "ChunkDefault/ChunkDefault.h"
 
 namespace Chunk {
 
+    /**
+     * Process-wide LRU of (model, query text) → query embedding, shared by all
+     * ChunkQuery instances so re-running a query or switching positions does
+     * not call the provider again. Embeddings are stored unprojected.
+     */
+    class QueryEmbeddingCache {
+    public:
+        using EmbeddingPtr = std::shared_ptr<const std::vector<float>>;
+
+        static QueryEmbeddingCache& Instance();
+
+        EmbeddingPtr Get(const std::string& model, const std::string& text);
+        void Put(const std::string& model, const std::string& text, EmbeddingPtr embedding);
+        void SetCapacity(size_t capacity);
+        void Clear(void);
+        size_t Size(void) const;
+        inline size_t Capacity(void) const { return m_capacity; }
+
+    private:
+        QueryEmbeddingCache() = default;
+        QueryEmbeddingCache(const QueryEmbeddingCache&) = delete;
+        QueryEmbeddingCache& operator=(const QueryEmbeddingCache&) = delete;
+
+        using Entry = std::pair<std::string, EmbeddingPtr>;
+        mutable std::mutex m_mutex;
+        size_t m_capacity = 1024;
+        std::list<Entry> m_lru; // most recent first
+        std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+    };
+
     class ChunkQuery {
     public:
         ChunkQuery(
@@ -19,7 +53,7 @@ namespace Chunk {
             float threshold = -5
         );
         ~ChunkQuery() = default;     
-        std::vector<std::tuple<std::string, float, int>> Retrieve(float threshold = 0.5, const Chunk::ChunkDefault* temp_chunks= nullptr, std::optional<size_t> pos = std::nullopt);  
+        std::vector<std::tuple<std::string, float, int>> Retrieve(float threshold = 0.5, const Chunk::ChunkDefault* temp_chunks= nullptr, std::optional<size_t> pos = std::nullopt, std::optional<std::string> partition = std::nullopt);  
         RAGLibrary::Document Query(RAGLibrary::Document query_doc = {}, const Chunk::ChunkDefault* temp_chunks = nullptr, std::optional<size_t> pos = std::nullopt); 
         RAGLibrary::Document Query(std::string query = "", const Chunk::ChunkDefault* temp_chunks = nullptr, std::optional<size_t> pos = std::nullopt);
         std::vector<std::tuple<std::string, float, int>> getRetrieveList(void) const;
@@ -46,11 +80,17 @@ namespace Chunk {
         std::vector<std::tuple<std::string, float, int>> m_retrieve_list; 
         size_t quant_retrieve_list = 0;
 
-        const std::vector<RAGLibrary::Document>* m_chunks_list = nullptr;
         const Chunk::ChunkDefault* m_chunks = nullptr;
         const Chunk::vdb_data* m_vdb = nullptr;
         
         std::vector<std::span<const float>> m_chunk_embedding;    
+        size_t m_generation = 0; // ChunkDefault generation m_vdb / m_chunk_embedding were taken from
+        // Points m_vdb and the row spans at element pos of chunks, leaving the query untouched
+        void BindElement(const Chunk::ChunkDefault& chunks, size_t pos);
+        // Rebinds after ChunkDefault::Append / CreateEmb moved the rows
+        void RefreshIfStale(void);
+        // Unprojected embedding of text for model, through QueryEmbeddingCache
+        std::vector<float> EmbedQuery(const std::string& text, const std::string& model);
         inline RAGLibrary::Document validateEmbeddingResult(const std::vector<RAGLibrary::Document>& results) {
             if (results.empty() || !results[0].embedding.has_value()) {
                 throw std::runtime_error("Embedding not present in result.");
@@ -3,19 +3,85 @@
 #include "RagException.h"
 #include "StringUtils.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <numeric>
 #include <omp.h>
 #include <syncstream>
 
 using namespace Chunk;
 
+namespace
+{
+    inline bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+    }
+
+    // Sentences of text, whitespace-trimmed: a sentence ends after '.', '!' or '?' followed
+    // by whitespace, or at a line break.
+    std::vector<Chunk::ChunkSpan> SplitSentences(std::string_view text)
+    {
+        std::vector<Chunk::ChunkSpan> sentences;
+        size_t start = 0;
+        auto emit = [&](size_t end)
+        {
+            while (start < end && IsSpace(text[start]))
+                ++start;
+            size_t stop = end;
+            while (stop > start && IsSpace(text[stop - 1]))
+                --stop;
+            if (stop > start)
+                sentences.emplace_back(start, stop - start);
+            start = end;
+        };
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            const char c = text[i];
+            if (c == '\n' || ((c == '.' || c == '!' || c == '?') && i + 1 < text.size() && IsSpace(text[i + 1])))
+                emit(i + 1);
+        }
+        emit(text.size());
+        return sentences;
+    }
+
+    float CosineDistance(const float *a, const float *b, size_t dim)
+    {
+        float dot = 0.0f, na = 0.0f, nb = 0.0f;
+        for (size_t k = 0; k < dim; k++)
+        {
+            dot += a[k] * b[k];
+            na += a[k] * a[k];
+            nb += b[k] * b[k];
+        }
+        const float norm = std::sqrt(na) * std::sqrt(nb);
+        return norm > 0.0f ? 1.0f - dot / norm : 1.0f;
+    }
+
+    // Linear-interpolated percentile (as numpy.percentile) in O(n) with nth_element
+    float Percentile(std::vector<float> values, float percentile)
+    {
+        const double pos = double(std::clamp(percentile, 0.0f, 100.0f)) / 100.0 * double(values.size() - 1);
+        const size_t lo = size_t(pos);
+        std::nth_element(values.begin(), values.begin() + lo, values.end());
+        const float low = values[lo];
+        if (lo + 1 >= values.size())
+            return low;
+        const float high = *std::min_element(values.begin() + lo + 1, values.end());
+        return low + float(pos - double(lo)) * (high - low);
+    }
+}
+
 ChunkSimilarity::ChunkSimilarity(
     const int chunk_size,
     const int overlap,
     std::string embedding_model,
-    const std::string &openai_api_key)
-    : m_chunk_size(chunk_size), m_overlap(overlap), m_embedding_model(to_lowercase(embedding_model))
+    const std::string &openai_api_key,
+    const float breakpoint_percentile,
+    const int buffer_size)
+    : m_chunk_size(chunk_size), m_overlap(overlap), m_embedding_model(to_lowercase(embedding_model)),
+      m_openai_api_key(openai_api_key), m_breakpoint_percentile(breakpoint_percentile), m_buffer_size(buffer_size)
 {
     ValidateModel();
 }
@@ -27,50 +93,104 @@ void ChunkSimilarity::ValidateModel()
         throw RAGLibrary::RagException("The overlap value must be smaller than the chunk size.");
     }
 
-    if(!Chunk::resolve_vendor(this->m_embedding_model)) 
+    if(!Chunk::resolve_vendor(this->m_embedding_model))
         throw RAGLibrary::RagException("Invalid model.");
 
+    if (m_breakpoint_percentile < 0.0f || m_breakpoint_percentile > 100.0f)
+        throw RAGLibrary::RagException("breakpoint_percentile must be in [0, 100].");
+
+    if (m_buffer_size < 0)
+        throw RAGLibrary::RagException("buffer_size cannot be negative.");
 }
 
-std::vector<std::vector<float>> ChunkSimilarity::GenerateEmbeddings(const std::vector<std::string> &chunks)
+size_t ChunkSimilarity::GenerateEmbeddings(const std::vector<std::string_view> &texts, std::vector<float> &matrix)
 {
-    std::vector<std::vector<float>> results;
+    // Windows go through the vendor registry and the embedding cache like any other embedding call
+    std::string model;
     if(this->m_embedding_model=="huggingface")
-        results = Chunk::EmbeddingHuggingFaceTransformers(chunks);
+        model = "all-MiniLM-L6-v2";
     else if(this->m_embedding_model=="openai")
-        results = Chunk::EmbeddingOpeanAI(chunks, m_openai_api_key);
-    return results;
+    {
+        model = "text-embedding-ada-002";
+        // An explicit key goes to the shared scheduler, which serves every OpenAI call
+        auto options = EmbeddingOpenAI::EmbeddingOpenAI::GetSchedulerOptions();
+        if (!m_openai_api_key.empty() && options.apiKey != m_openai_api_key)
+        {
+            options.apiKey = m_openai_api_key;
+            EmbeddingOpenAI::EmbeddingOpenAI::SetSchedulerOptions(options);
+        }
+    }
+    else
+        throw RAGLibrary::RagException("Vendor handler for '" + m_embedding_model + "' not implemented.");
+
+    Embedding::MatrixSink sink(matrix, texts.size());
+    Chunk::EmbedInto(texts, model, sink);
+    return sink.Dim();
 }
 
-std::vector<RAGLibrary::Document> ChunkSimilarity::ProcessSingleDocument(const RAGLibrary::Document &item)
+std::vector<Chunk::ChunkSpan> ChunkSimilarity::GroupSentences(std::string_view text, const std::vector<Chunk::ChunkSpan> &sentences, const float *embeddings, size_t dim) const
 {
-    std::vector<RAGLibrary::Document> documents;
-    try
+    const size_t n = sentences.size();
+    const size_t max_bytes = size_t(m_chunk_size);
+
+    // Distance between the windows of sentence k and k+1; a boundary goes after k when it spikes
+    std::vector<bool> breakpoint(n, false);
+    if (n > 1 && embeddings != nullptr)
     {
-        auto chunks = Chunk::SplitText(item.page_content, m_overlap, m_chunk_size);
-        auto embeddings = GenerateEmbeddings(chunks);
-        auto embeddingsTensor = Chunk::toTensor(embeddings);
-        auto similarity_matrix = torch::inner(embeddingsTensor, embeddingsTensor);
-        auto sorted_indices = torch::argsort(-similarity_matrix.sum(1));
-
-        documents.reserve(documents.size() + chunks.size());
-        for (int i = 0; i < sorted_indices.size(0); i++)
+        std::vector<float> distances(n - 1);
+        for (size_t k = 0; k + 1 < n; k++)
+            distances[k] = CosineDistance(embeddings + k * dim, embeddings + (k + 1) * dim, dim);
+        const float threshold = Percentile(distances, m_breakpoint_percentile);
+        for (size_t k = 0; k + 1 < n; k++)
+            breakpoint[k] = distances[k] > threshold;
+    }
+
+    std::vector<Chunk::ChunkSpan> chunks;
+    auto emit = [&](size_t begin, size_t end)
+    {
+        if (end - begin <= max_bytes)
         {
-            auto j = sorted_indices[i].item<int64_t>();
-            documents.push_back(RAGLibrary::Document(item.metadata, chunks[j]));
+            chunks.emplace_back(begin, end - begin);
+            return;
         }
-    }
-    catch (const std::exception &e)
+        // A single sentence longer than chunk_size falls back to fixed-size pieces
+        for (const auto &[offset, length] : Chunk::SplitTextSpans(text.substr(begin, end - begin), m_overlap, m_chunk_size))
+            chunks.emplace_back(begin + offset, length);
+    };
+
+    size_t first = 0;
+    for (size_t k = 0; k < n; k++)
     {
-        std::cerr << e.what() << std::endl;
-        throw;
+        const size_t begin = sentences[first].first;
+        const size_t end = sentences[k].first + sentences[k].second;
+        // Close the group before sentence k when it would overflow chunk_size
+        if (k > first && end - begin > max_bytes)
+        {
+            emit(begin, sentences[k - 1].first + sentences[k - 1].second);
+            first = k;
+        }
+        if (breakpoint[k] || k + 1 == n)
+        {
+            emit(sentences[first].first, end);
+            first = k + 1;
+        }
     }
+    return chunks;
+}
 
-    return documents;
+std::vector<RAGLibrary::Document> ChunkSimilarity::ProcessSingleDocument(const RAGLibrary::Document &item)
+{
+    return ProcessDocuments({item}, 1);
 }
 
 std::vector<RAGLibrary::Document> ChunkSimilarity::ProcessDocuments(const std::vector<RAGLibrary::Document> &items, int max_workers)
 {
+    const int n_items = int(items.size());
+    const size_t buffer = size_t(m_buffer_size);
+    std::vector<std::vector<Chunk::ChunkSpan>> sentences(n_items);
+    std::vector<std::vector<Chunk::ChunkSpan>> spans(n_items);
+    std::vector<size_t> window_offsets(n_items + 1, 0);
+    std::vector<size_t> offsets(n_items + 1, 0);
     std::vector<RAGLibrary::Document> documents;
     try
     {
@@ -80,16 +200,56 @@ std::vector<RAGLibrary::Document> ChunkSimilarity::ProcessDocuments(const std::v
             max_threads = max_workers;
         }
 
-        omp_set_num_threads(max_threads);
-#pragma omp parallel for
-        for (int i = 0; i < items.size(); i++)
+#pragma omp parallel for schedule(dynamic) num_threads(max_threads)
+        for (int i = 0; i < n_items; i++)
+        {
+            sentences[i] = SplitSentences(items[i].page_content);
+            // Documents with a single sentence need no embeddings
+            window_offsets[i + 1] = sentences[i].size() > 1 ? sentences[i].size() : 0;
+        }
+        std::inclusive_scan(window_offsets.begin(), window_offsets.end(), window_offsets.begin());
+
+        // One window per sentence: the sentence with `buffer` neighbours on each side, as a
+        // view of the document text; every window of every document goes in one batch
+        std::vector<std::string_view> windows(window_offsets.back());
+#pragma omp parallel for schedule(dynamic) num_threads(max_threads)
+        for (int i = 0; i < n_items; i++)
+        {
+            const std::string_view text = items[i].page_content;
+            const auto &sent = sentences[i];
+            const size_t n = window_offsets[i + 1] - window_offsets[i];
+            for (size_t k = 0; k < n; k++)
+            {
+                const size_t lo = sent[k >= buffer ? k - buffer : 0].first;
+                const auto &last = sent[std::min(n - 1, k + buffer)];
+                windows[window_offsets[i] + k] = text.substr(lo, last.first + last.second - lo);
+            }
+        }
+
+        std::vector<float> embeddings;
+        const size_t dim = windows.empty() ? 0 : GenerateEmbeddings(windows, embeddings);
+
+#pragma omp parallel for schedule(dynamic) num_threads(max_threads)
+        for (int i = 0; i < n_items; i++)
+        {
+            const bool embedded = window_offsets[i + 1] > window_offsets[i];
+            spans[i] = GroupSentences(items[i].page_content, sentences[i], embedded ? embeddings.data() + window_offsets[i] * dim : nullptr, dim);
+            offsets[i + 1] = spans[i].size();
+        }
+
+        std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+        documents.resize(offsets.back());
+
+#pragma omp parallel for schedule(dynamic) num_threads(max_threads)
+        for (int i = 0; i < n_items; i++)
         {
-            auto &item = items[i];
-            auto docs = ProcessSingleDocument(item);
-#pragma omp critical
+            const auto &item = items[i];
+            auto out = documents.begin() + offsets[i];
+            for (const auto &[offset, length] : spans[i])
             {
-                documents.reserve(documents.size() + docs.size());
-                documents.insert(documents.end(), docs.begin(), docs.end());
+                out->metadata = item.metadata;
+                out->page_content.assign(item.page_content, offset, length);
+                ++out;
             }
         }
     }
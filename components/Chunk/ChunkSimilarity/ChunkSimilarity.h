@@ -4,11 +4,20 @@
 #include "ChunkCommons/ChunkCommons.h"
 #include "CommonStructs.h"
 
+#include <string_view>
 #include <vector>
 
 namespace Chunk
 {
 
+    /**
+     * Semantic chunking: documents are split into sentences, each sentence is
+     * embedded together with buffer_size neighbours on either side, and a chunk
+     * boundary is placed wherever the cosine distance between adjacent windows
+     * exceeds the breakpoint_percentile of the document's distances. Chunks are
+     * also capped at chunk_size bytes. All windows of all documents go through
+     * one batched embedding call; memory is linear in the number of sentences.
+     */
     class ChunkSimilarity
     {
 
@@ -17,20 +26,27 @@ namespace Chunk
         ChunkSimilarity(const int chunk_size = 100,
                         const int overlap = 20,
                         std::string embedding_model = "openai",
-                        const std::string &openai_api_key = "");
+                        const std::string &openai_api_key = "",
+                        const float breakpoint_percentile = 95.0f,
+                        const int buffer_size = 1);
 
         std::vector<RAGLibrary::Document> ProcessSingleDocument(const RAGLibrary::Document &item);
         std::vector<RAGLibrary::Document> ProcessDocuments(const std::vector<RAGLibrary::Document> &items, int max_workers = 4);
 
     protected:
         void ValidateModel();
-        std::vector<std::vector<float>> GenerateEmbeddings(const std::vector<std::string> &chunks);
+        // Row i of `matrix` ([texts.size(), dim]) receives the embedding of texts[i]; returns dim
+        size_t GenerateEmbeddings(const std::vector<std::string_view> &texts, std::vector<float> &matrix);
+        // Chunks of one document from its sentence spans and their window embeddings (rows of `embeddings`)
+        std::vector<Chunk::ChunkSpan> GroupSentences(std::string_view text, const std::vector<Chunk::ChunkSpan> &sentences, const float *embeddings, size_t dim) const;
 
     private:
         int m_chunk_size;
         int m_overlap;
         std::string m_embedding_model;
         std::string m_openai_api_key;
+        float m_breakpoint_percentile;
+        int m_buffer_size;
     };
 
 }
@@ -0,0 +1,302 @@
+#include "ChunkTokens.h"
+#include "ChunkCommons/VendorRegistry.h"
+#include "Embedding/EmbeddingModel/ModelRegistry.h"
+#include "FileUtilsLocal.h"
+#include "RagException.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <omp.h>
+#include <unordered_map>
+
+using namespace Chunk;
+
+namespace
+{
+    // Tokenizer calls are batched to bound the memory of the id vectors
+    constexpr size_t kEncodeBatch = 16384;
+
+    inline bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    inline bool IsContinuation(char c)
+    {
+        return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+    }
+
+    // Team size for a parallel region, capped by max_workers; passed as num_threads so the
+    // caller's default team size is left untouched
+    inline int WorkerThreads(int max_workers)
+    {
+        int max_threads = omp_get_max_threads();
+        if (max_workers > 0 && max_workers < max_threads)
+        {
+            max_threads = max_workers;
+        }
+        return max_threads;
+    }
+
+    // Piece ends of text: each piece is leading whitespace plus one word, matching how
+    // BERT and byte-level BPE pre-tokenizers split, so piece token counts add up to the
+    // count of their concatenation. Runs without whitespace (CJK, URLs, base64) are cut at
+    // code point boundaries every max_bytes; a token never covers less than a byte, so a
+    // piece never has more tokens than bytes.
+    std::vector<size_t> SplitPieces(std::string_view text, size_t max_bytes)
+    {
+        std::vector<size_t> ends;
+        size_t start = 0;
+        size_t i = 0;
+        while (i < text.size())
+        {
+            while (i < text.size() && IsSpace(text[i]))
+                ++i;
+            while (i < text.size() && !IsSpace(text[i]))
+            {
+                ++i;
+                if (i - start >= max_bytes && i < text.size() && !IsContinuation(text[i]))
+                {
+                    ends.push_back(i);
+                    start = i;
+                }
+            }
+            if (i > start)
+            {
+                ends.push_back(i);
+                start = i;
+            }
+        }
+        return ends;
+    }
+}
+
+ChunkTokens::ChunkTokens(
+    const std::string &tokenizer,
+    const int chunk_tokens,
+    const int overlap_tokens)
+    : m_chunk_tokens(chunk_tokens), m_overlap_tokens(overlap_tokens)
+{
+    const bool isFile = tokenizer.ends_with(".json");
+    const std::string path = isFile ? tokenizer : Embedding::ModelRegistry::TokenizerPath(Chunk::LocalModelDir(tokenizer));
+    if (!std::filesystem::exists(path))
+    {
+        throw RAGLibrary::RagException("Tokenizer not found at " + path +
+                                       (isFile ? "" : "; export it with: python scripts/hf_extract_model.py -m " + Chunk::LocalModelDir(tokenizer)));
+    }
+    m_tokenizer = tokenizers::Tokenizer::FromBlobJSON(RAGLibrary::FileReader(path));
+    // [CLS]/[SEP] (or none) that Encode adds to every sequence, as the embedding models see it
+    m_special_tokens = m_tokenizer->Encode("").size();
+
+    if (m_overlap_tokens < 0 || m_chunk_tokens <= int(m_special_tokens) || m_overlap_tokens >= m_chunk_tokens - int(m_special_tokens))
+    {
+        throw RAGLibrary::RagException("The overlap value must be smaller than the chunk size.");
+    }
+}
+
+std::vector<uint32_t> ChunkTokens::CountTokens(const std::vector<std::string_view> &pieces)
+{
+    std::vector<uint32_t> counts(pieces.size());
+    std::vector<std::string> batch;
+    for (size_t first = 0; first < pieces.size(); first += kEncodeBatch)
+    {
+        const size_t last = std::min(pieces.size(), first + kEncodeBatch);
+        batch.assign(pieces.begin() + first, pieces.begin() + last);
+        std::vector<std::vector<int32_t>> ids;
+        {
+            std::lock_guard lock(m_tokenizer_mutex);
+            ids = m_tokenizer->EncodeBatch(batch);
+        }
+        for (size_t k = 0; k < ids.size(); k++)
+        {
+            counts[first + k] = uint32_t(ids[k].size() > m_special_tokens ? ids[k].size() - m_special_tokens : 0);
+        }
+    }
+    return counts;
+}
+
+std::vector<std::vector<Chunk::ChunkSpan>> ChunkTokens::SplitSpans(const std::vector<std::string_view> &texts, int max_workers)
+{
+    const int n_texts = int(texts.size());
+    const size_t budget = size_t(m_chunk_tokens) - m_special_tokens;
+    const size_t overlap = size_t(m_overlap_tokens);
+
+    const int max_threads = WorkerThreads(max_workers);
+
+    // 1. Pieces of every text, in parallel
+    std::vector<std::vector<size_t>> ends(n_texts);
+#pragma omp parallel for schedule(dynamic) num_threads(max_threads)
+    for (int i = 0; i < n_texts; i++)
+    {
+        ends[i] = SplitPieces(texts[i], budget);
+    }
+
+    // 2. Each distinct piece is tokenized once, in one batch over all texts
+    std::unordered_map<std::string_view, uint32_t> piece_id;
+    std::vector<std::string_view> unique;
+    std::vector<std::vector<uint32_t>> ids(n_texts);
+    for (int i = 0; i < n_texts; i++)
+    {
+        ids[i].reserve(ends[i].size());
+        size_t start = 0;
+        for (size_t end : ends[i])
+        {
+            const std::string_view piece = texts[i].substr(start, end - start);
+            auto [it, inserted] = piece_id.try_emplace(piece, uint32_t(unique.size()));
+            if (inserted)
+                unique.push_back(piece);
+            ids[i].push_back(it->second);
+            start = end;
+        }
+    }
+    const std::vector<uint32_t> counts = CountTokens(unique);
+
+    // 3. Greedy packing: as many pieces as fit the budget, then step back by up to `overlap` tokens
+    std::vector<std::vector<Chunk::ChunkSpan>> spans(n_texts);
+#pragma omp parallel for schedule(dynamic) num_threads(max_threads)
+    for (int i = 0; i < n_texts; i++)
+    {
+        const std::string_view text = texts[i];
+        const auto &piece_end = ends[i];
+        const size_t m = piece_end.size();
+        auto tokens = [&](size_t k) { return size_t(counts[ids[i][k]]); };
+        auto piece_start = [&](size_t k) { return k == 0 ? size_t(0) : piece_end[k - 1]; };
+
+        size_t s = 0;
+        while (s < m)
+        {
+            size_t e = s;
+            size_t used = 0;
+            while (e < m && used + tokens(e) <= budget)
+                used += tokens(e++);
+            if (e == s)
+                e = s + 1;
+
+            size_t lo = piece_start(s);
+            size_t hi = piece_end[e - 1];
+            while (lo < hi && IsSpace(text[lo]))
+                ++lo;
+            while (hi > lo && IsSpace(text[hi - 1]))
+                --hi;
+            if (hi > lo)
+                spans[i].emplace_back(lo, hi - lo);
+            if (e == m)
+                break;
+
+            size_t next = e;
+            size_t repeated = 0;
+            while (next > s + 1 && repeated + tokens(next - 1) <= overlap)
+                repeated += tokens(--next);
+            s = next;
+        }
+    }
+    return spans;
+}
+
+std::vector<RAGLibrary::Document> ChunkTokens::ProcessSingleDocument(RAGLibrary::Document &item)
+{
+    std::vector<RAGLibrary::Document> documents;
+    try
+    {
+        auto spans = SplitSpans({item.page_content}, 1).front();
+        documents.reserve(spans.size());
+        for (const auto &[offset, length] : spans)
+        {
+            documents.push_back(RAGLibrary::Document(item.metadata, item.page_content.substr(offset, length)));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        throw;
+    }
+
+    return documents;
+}
+
+std::vector<RAGLibrary::Document> ChunkTokens::ProcessDocuments(const std::vector<RAGLibrary::Document> &items, int max_workers)
+{
+    // Spans of all documents, prefix sum, then each document fills its own slice
+    const int n_items = int(items.size());
+    std::vector<size_t> offsets(n_items + 1, 0);
+    std::vector<RAGLibrary::Document> documents;
+    try
+    {
+        std::vector<std::string_view> texts;
+        texts.reserve(items.size());
+        for (const auto &item : items)
+        {
+            texts.push_back(item.page_content);
+        }
+        auto spans = SplitSpans(texts, max_workers);
+        for (int i = 0; i < n_items; i++)
+        {
+            offsets[i + 1] = spans[i].size();
+        }
+        std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+        documents.resize(offsets.back());
+
+#pragma omp parallel for schedule(dynamic) num_threads(WorkerThreads(max_workers))
+        for (int i = 0; i < n_items; i++)
+        {
+            const auto &item = items[i];
+            auto out = documents.begin() + offsets[i];
+            for (const auto &[offset, length] : spans[i])
+            {
+                out->metadata = item.metadata;
+                out->page_content.assign(item.page_content, offset, length);
+                ++out;
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        throw;
+    }
+
+    return documents;
+}
+
+std::vector<Chunk::ChunkView> ChunkTokens::ProcessDocumentViews(std::vector<RAGLibrary::Document> items, int max_workers)
+{
+    // Each document's text is moved into one shared buffer; chunks are spans of it
+    const int n_items = int(items.size());
+    std::vector<Chunk::SourcePtr> sources(n_items);
+    std::vector<std::string_view> texts(n_items);
+    std::vector<size_t> offsets(n_items + 1, 0);
+    std::vector<Chunk::ChunkView> views;
+    try
+    {
+        for (int i = 0; i < n_items; i++)
+        {
+            sources[i] = Chunk::MakeSource(std::move(items[i].metadata), std::move(items[i].page_content));
+            texts[i] = sources[i]->text;
+        }
+        auto spans = SplitSpans(texts, max_workers);
+        for (int i = 0; i < n_items; i++)
+        {
+            offsets[i + 1] = spans[i].size();
+        }
+        std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+        views.resize(offsets.back());
+
+#pragma omp parallel for schedule(dynamic) num_threads(WorkerThreads(max_workers))
+        for (int i = 0; i < n_items; i++)
+        {
+            auto out = views.begin() + offsets[i];
+            for (const auto &[offset, length] : spans[i])
+            {
+                *out++ = Chunk::ChunkView{sources[i], offset, length};
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        throw;
+    }
+
+    return views;
+}
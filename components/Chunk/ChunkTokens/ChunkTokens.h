@@ -0,0 +1,55 @@
+#ifndef CHUNK_TOKENS_H
+#define CHUNK_TOKENS_H
+
+#include "CommonStructs.h"
+#include "ChunkCommons/ChunkView.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tokenizers_cpp.h"
+
+namespace Chunk
+{
+    /**
+     * Splits documents into chunks measured in model tokens instead of bytes.
+     * chunk_tokens is the model window including special tokens ([CLS]/[SEP]),
+     * so chunks fill it without truncation; overlap_tokens is repeated between
+     * neighbouring chunks. Chunks are byte ranges of the source text that end
+     * on word boundaries.
+     */
+    class ChunkTokens
+    {
+
+    public:
+        // tokenizer: local model name ("bge-small"), a directory under models/, or a path to a tokenizer.json
+        ChunkTokens(const std::string &tokenizer = "bge-small", const int chunk_tokens = 512, const int overlap_tokens = 64);
+        ~ChunkTokens() = default;
+
+        std::vector<RAGLibrary::Document> ProcessSingleDocument(RAGLibrary::Document &item);
+        std::vector<RAGLibrary::Document> ProcessDocuments(const std::vector<RAGLibrary::Document> &items, int max_workers = 4);
+        // Same chunks as (shared document buffer, offset, length) views, in document order
+        std::vector<Chunk::ChunkView> ProcessDocumentViews(std::vector<RAGLibrary::Document> items, int max_workers = 4);
+        // Chunk spans of every text; all texts are tokenized in one batch
+        std::vector<std::vector<Chunk::ChunkSpan>> SplitSpans(const std::vector<std::string_view> &texts, int max_workers = 4);
+
+        inline int getChunkTokens(void) const { return m_chunk_tokens; }
+        inline int getOverlapTokens(void) const { return m_overlap_tokens; }
+
+    protected:
+        // Token count of each piece, without special tokens
+        std::vector<uint32_t> CountTokens(const std::vector<std::string_view> &pieces);
+
+    private:
+        std::unique_ptr<tokenizers::Tokenizer> m_tokenizer;
+        std::mutex m_tokenizer_mutex; // tokenizers::Tokenizer is not thread-safe
+        int m_chunk_tokens;
+        int m_overlap_tokens;
+        size_t m_special_tokens = 0;
+    };
+
+}
+#endif
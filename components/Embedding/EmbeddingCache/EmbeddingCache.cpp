@@ -0,0 +1,378 @@
+#include "EmbeddingCache.h"
+#include "RagException.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr char kMagic[8] = {'P', 'C', 'E', 'M', 'B', 'C', '0', '1'};
+    constexpr uint32_t kVersion = 1;
+    constexpr uint32_t kRecordMarker = 0x52424D45; // "EMBR"
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t modelHash;
+        uint64_t reserved2;
+    };
+
+    struct RecordHeader
+    {
+        uint32_t marker;
+        uint32_t dim;
+        uint64_t h1;
+        uint64_t h2;
+    };
+
+    static_assert(sizeof(FileHeader) == 32);
+    static_assert(sizeof(RecordHeader) == 24);
+
+    std::string SanitizeFileName(const std::string &model)
+    {
+        std::string out = model;
+        for (char &c : out)
+        {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.')
+                c = '_';
+        }
+        return out;
+    }
+
+#ifndef _WIN32
+    // Holds an flock for the lifetime of the scope.
+    struct FileLock
+    {
+        FileLock(int fd, int op) : m_fd(fd)
+        {
+            while (flock(m_fd, op) != 0)
+            {
+                if (errno != EINTR)
+                    throw RAGLibrary::RagException("Embedding cache: flock failed: " + std::string(std::strerror(errno)));
+            }
+        }
+        ~FileLock() { flock(m_fd, LOCK_UN); }
+        int m_fd;
+    };
+#endif
+}
+
+namespace Embedding
+{
+    EmbeddingCache::Key EmbeddingCache::HashContent(std::string_view text)
+    {
+        // Two FNV-1a streams with different bases; the length is folded into the second.
+        uint64_t h1 = 0xCBF29CE484222325ULL;
+        uint64_t h2 = 0x84222325CBF29CE4ULL ^ uint64_t(text.size());
+        for (unsigned char c : text)
+        {
+            h1 = (h1 ^ c) * 0x100000001B3ULL;
+            h2 = (h2 ^ c) * 0x100000001B3ULL;
+            h2 ^= h2 >> 29;
+        }
+        return {h1, h2};
+    }
+
+    std::string EmbeddingCache::DefaultDir()
+    {
+        if (const char *env = std::getenv("PURECPP_EMBEDDING_CACHE"); env && *env)
+            return env;
+        if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+            return std::string(xdg) + "/purecpp/embeddings";
+        if (const char *home = std::getenv("HOME"); home && *home)
+            return std::string(home) + "/.cache/purecpp/embeddings";
+        return ".purecpp_cache/embeddings";
+    }
+
+    std::shared_ptr<EmbeddingCache> EmbeddingCache::ForModel(const std::string &model)
+    {
+#ifdef _WIN32
+        (void)model;
+        return nullptr;
+#else
+        const std::string dir = DefaultDir();
+        if (dir == "off" || dir == "0")
+            return nullptr;
+
+        static std::mutex mtx;
+        static std::map<std::string, std::shared_ptr<EmbeddingCache>> caches;
+        std::scoped_lock lock(mtx);
+        auto &cache = caches[dir + "/" + model];
+        if (!cache)
+        {
+            try
+            {
+                cache = std::make_shared<EmbeddingCache>(model, dir);
+            }
+            catch (const std::exception &e)
+            {
+                // The cache is an optimization: fall back to always calling the provider
+                std::cerr << "[EmbeddingCache] disabled for '" << model << "': " << e.what() << "\n";
+                return nullptr;
+            }
+        }
+        return cache;
+#endif
+    }
+
+#ifndef _WIN32
+    EmbeddingCache::EmbeddingCache(const std::string &model, const std::string &dir)
+        : m_model(model), m_path(dir + "/" + SanitizeFileName(model) + ".embc")
+    {
+        std::filesystem::create_directories(dir);
+        m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (m_fd < 0)
+            throw RAGLibrary::RagException("Embedding cache: cannot open " + m_path + ": " + std::strerror(errno));
+
+        const uint64_t modelHash = HashContent(model).h1;
+        {
+            FileLock lock(m_fd, LOCK_EX);
+            struct stat st{};
+            fstat(m_fd, &st);
+            if (st.st_size == 0)
+            {
+                FileHeader header{};
+                std::memcpy(header.magic, kMagic, sizeof(kMagic));
+                header.version = kVersion;
+                header.modelHash = modelHash;
+                if (::pwrite(m_fd, &header, sizeof(header), 0) != ssize_t(sizeof(header)))
+                {
+                    ::close(m_fd);
+                    throw RAGLibrary::RagException("Embedding cache: cannot write header to " + m_path);
+                }
+            }
+
+            FileHeader header{};
+            if (::pread(m_fd, &header, sizeof(header), 0) != ssize_t(sizeof(header)) ||
+                std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+                header.version != kVersion || header.modelHash != modelHash)
+            {
+                ::close(m_fd);
+                throw RAGLibrary::RagException("Embedding cache: " + m_path + " is not a cache file for model '" + model + "'");
+            }
+        }
+
+        m_scanned = sizeof(FileHeader);
+        Refresh();
+    }
+
+    EmbeddingCache::~EmbeddingCache()
+    {
+        if (m_map)
+            munmap(m_map, m_mapped);
+        if (m_fd >= 0)
+            ::close(m_fd);
+    }
+
+    void EmbeddingCache::Remap(uint64_t size)
+    {
+        if (size <= m_mapped)
+            return;
+        void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (map == MAP_FAILED)
+            throw RAGLibrary::RagException("Embedding cache: mmap failed: " + std::string(std::strerror(errno)));
+        if (m_map)
+            munmap(m_map, m_mapped);
+        m_map = map;
+        m_mapped = size;
+    }
+
+    // Caller holds m_mutex and a shared or exclusive flock.
+    void EmbeddingCache::RefreshLocked()
+    {
+        struct stat st{};
+        if (fstat(m_fd, &st) != 0 || uint64_t(st.st_size) <= m_scanned)
+            return;
+
+        const uint64_t size = uint64_t(st.st_size);
+        Remap(size);
+
+        const char *base = static_cast<const char *>(m_map);
+        uint64_t pos = m_scanned;
+        while (pos + sizeof(RecordHeader) <= size)
+        {
+            RecordHeader rec;
+            std::memcpy(&rec, base + pos, sizeof(rec));
+            const uint64_t end = pos + sizeof(rec) + uint64_t(rec.dim) * sizeof(float);
+            // A torn tail (crash mid-append) stops the scan; the next writer truncates it
+            if (rec.marker != kRecordMarker || end > size)
+                break;
+            m_index.insert_or_assign(Key{rec.h1, rec.h2}, Entry{pos + sizeof(rec), rec.dim});
+            pos = end;
+        }
+        m_scanned = pos;
+    }
+
+    void EmbeddingCache::Refresh()
+    {
+        std::scoped_lock lock(m_mutex);
+        FileLock flk(m_fd, LOCK_SH);
+        RefreshLocked();
+    }
+
+    void EmbeddingCache::Append(const std::vector<std::pair<Key, std::span<const float>>> &records)
+    {
+        if (records.empty())
+            return;
+
+        std::scoped_lock lock(m_mutex);
+        FileLock flk(m_fd, LOCK_EX);
+        RefreshLocked();
+
+        struct stat st{};
+        fstat(m_fd, &st);
+        if (uint64_t(st.st_size) > m_scanned && ::ftruncate(m_fd, off_t(m_scanned)) != 0)
+            throw RAGLibrary::RagException("Embedding cache: cannot truncate torn tail of " + m_path);
+
+        std::vector<char> buffer;
+        for (const auto &[key, emb] : records)
+        {
+            if (emb.empty() || m_index.contains(key))
+                continue;
+            RecordHeader rec{kRecordMarker, uint32_t(emb.size()), key.h1, key.h2};
+            const size_t at = buffer.size();
+            buffer.resize(at + sizeof(rec) + emb.size_bytes());
+            std::memcpy(buffer.data() + at, &rec, sizeof(rec));
+            std::memcpy(buffer.data() + at + sizeof(rec), emb.data(), emb.size_bytes());
+        }
+
+        size_t written = 0;
+        while (written < buffer.size())
+        {
+            ssize_t n = ::pwrite(m_fd, buffer.data() + written, buffer.size() - written, off_t(m_scanned + written));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw RAGLibrary::RagException("Embedding cache: write failed on " + m_path);
+            written += size_t(n);
+        }
+        RefreshLocked();
+    }
+#else
+    EmbeddingCache::EmbeddingCache(const std::string &model, const std::string &dir)
+    {
+        (void)model;
+        (void)dir;
+        throw RAGLibrary::RagException("Embedding cache is not supported on this platform.");
+    }
+    EmbeddingCache::~EmbeddingCache() = default;
+    void EmbeddingCache::Remap(uint64_t) {}
+    void EmbeddingCache::RefreshLocked() {}
+    void EmbeddingCache::Refresh() {}
+    void EmbeddingCache::Append(const std::vector<std::pair<Key, std::span<const float>>> &) {}
+#endif
+
+    std::vector<float> EmbeddingCache::Read(const Entry &entry) const
+    {
+        std::vector<float> out(entry.dim);
+        std::memcpy(out.data(), static_cast<const char *>(m_map) + entry.offset, size_t(entry.dim) * sizeof(float));
+        return out;
+    }
+
+    std::optional<std::vector<float>> EmbeddingCache::Get(std::string_view text)
+    {
+        const Key key = HashContent(text);
+        {
+            std::scoped_lock lock(m_mutex);
+            if (auto it = m_index.find(key); it != m_index.end())
+                return Read(it->second);
+        }
+        Refresh();
+        std::scoped_lock lock(m_mutex);
+        if (auto it = m_index.find(key); it != m_index.end())
+            return Read(it->second);
+        return std::nullopt;
+    }
+
+    void EmbeddingCache::Put(std::string_view text, std::span<const float> embedding)
+    {
+        Append({{HashContent(text), embedding}});
+    }
+
+    std::vector<size_t> EmbeddingCache::Fill(std::vector<RAGLibrary::Document> &docs)
+    {
+        Refresh();
+
+        std::vector<size_t> misses;
+        std::scoped_lock lock(m_mutex);
+        for (size_t i = 0; i < docs.size(); ++i)
+        {
+            auto it = m_index.find(HashContent(docs[i].page_content));
+            if (it == m_index.end())
+            {
+                misses.push_back(i);
+                continue;
+            }
+            docs[i].embedding = Read(it->second);
+        }
+        return misses;
+    }
+
+    void EmbeddingCache::Store(const std::vector<RAGLibrary::Document> &docs, const std::vector<size_t> &indices)
+    {
+        std::vector<std::pair<Key, std::span<const float>>> records;
+        records.reserve(indices.size());
+        for (size_t i : indices)
+        {
+            if (i < docs.size() && docs[i].embedding.has_value())
+                records.emplace_back(HashContent(docs[i].page_content), std::span<const float>(*docs[i].embedding));
+        }
+        Append(records);
+    }
+
+    std::vector<size_t> EmbeddingCache::Fill(const std::vector<std::string_view> &texts, EmbeddingSink &sink)
+    {
+        Refresh();
+
+        std::vector<size_t> misses;
+        std::scoped_lock lock(m_mutex);
+        for (size_t i = 0; i < texts.size(); ++i)
+        {
+            auto it = m_index.find(HashContent(texts[i]));
+            if (it == m_index.end())
+            {
+                misses.push_back(i);
+                continue;
+            }
+            sink.SetDim(it->second.dim);
+            std::memcpy(sink.Row(i), static_cast<const char *>(m_map) + it->second.offset, size_t(it->second.dim) * sizeof(float));
+        }
+        return misses;
+    }
+
+    void EmbeddingCache::Store(const std::vector<std::string_view> &texts, const std::vector<size_t> &indices, EmbeddingSink &sink)
+    {
+        const size_t dim = sink.Dim();
+        if (dim == 0)
+            return;
+        std::vector<std::pair<Key, std::span<const float>>> records;
+        records.reserve(indices.size());
+        for (size_t i : indices)
+        {
+            if (i < texts.size())
+                records.emplace_back(HashContent(texts[i]), std::span<const float>(sink.Row(i), dim));
+        }
+        Append(records);
+    }
+
+    size_t EmbeddingCache::Size() const
+    {
+        std::scoped_lock lock(m_mutex);
+        return m_index.size();
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef EMBEDDING_CACHE_H
+#define EMBEDDING_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "CommonStructs.h"
+#include "Embedding/EmbeddingSink.h"
+
+namespace Embedding
+{
+    /**
+     * Persistent, content-addressed embedding store for one model.
+     *
+     * One append-only file per model (<dir>/<model>.embc) holds records of
+     * { content hash, dim, floats }. The file is mmap'd for reads and an
+     * in-memory hash index maps content hashes to record offsets. Appends
+     * take an exclusive flock and tail scans a shared one, so several
+     * processes can share the same directory; records appended by other
+     * processes are picked up by Refresh().
+     *
+     * Configured by PURECPP_EMBEDDING_CACHE: a directory, or "off" to disable.
+     */
+    class EmbeddingCache
+    {
+    public:
+        struct Key
+        {
+            uint64_t h1 = 0;
+            uint64_t h2 = 0;
+            bool operator==(const Key &other) const = default;
+        };
+
+        // Process-wide instance per model; nullptr when the cache is disabled.
+        static std::shared_ptr<EmbeddingCache> ForModel(const std::string &model);
+        static std::string DefaultDir();
+        static Key HashContent(std::string_view text);
+
+        EmbeddingCache(const std::string &model, const std::string &dir);
+        ~EmbeddingCache();
+        EmbeddingCache(const EmbeddingCache &) = delete;
+        EmbeddingCache &operator=(const EmbeddingCache &) = delete;
+
+        std::optional<std::vector<float>> Get(std::string_view text);
+        void Put(std::string_view text, std::span<const float> embedding);
+
+        // Sets cached embeddings on docs and returns the indices still to be embedded.
+        std::vector<size_t> Fill(std::vector<RAGLibrary::Document> &docs);
+        // Appends the embeddings of docs[indices] that are not stored yet, in one write.
+        void Store(const std::vector<RAGLibrary::Document> &docs, const std::vector<size_t> &indices);
+        // Same, writing hits straight into sink rows / reading stored rows from the sink.
+        std::vector<size_t> Fill(const std::vector<std::string_view> &texts, EmbeddingSink &sink);
+        void Store(const std::vector<std::string_view> &texts, const std::vector<size_t> &indices, EmbeddingSink &sink);
+
+        // Maps and indexes records appended since the last scan (possibly by other processes).
+        void Refresh();
+        size_t Size() const;
+        inline const std::string &Path() const { return m_path; }
+
+    private:
+        struct KeyHash
+        {
+            size_t operator()(const Key &k) const noexcept { return size_t(k.h1 ^ (k.h2 * 0x9E3779B97F4A7C15ULL)); }
+        };
+        struct Entry
+        {
+            uint64_t offset; // of the first float
+            uint32_t dim;
+        };
+
+        void RefreshLocked();
+        void Remap(uint64_t size);
+        void Append(const std::vector<std::pair<Key, std::span<const float>>> &records);
+        std::vector<float> Read(const Entry &entry) const;
+
+        std::string m_model;
+        std::string m_path;
+        int m_fd = -1;
+        void *m_map = nullptr;
+        uint64_t m_mapped = 0;
+        uint64_t m_scanned = 0;
+        mutable std::mutex m_mutex;
+        std::unordered_map<Key, Entry, KeyHash> m_index;
+    };
+    using EmbeddingCachePtr = std::shared_ptr<EmbeddingCache>;
+}
+
+#endif // EMBEDDING_CACHE_H
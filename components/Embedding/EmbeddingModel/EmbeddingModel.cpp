@@ -4,24 +4,29 @@
 
 std::vector<RAGLibrary::Document> Embedding::EmbeddingModel::GenerateEmbeddings(const std::vector<RAGLibrary::Document> &documents, const std::string &model, size_t batch_size)
 {
-    std::vector<std::string> chunks_str;
-    chunks_str.reserve(documents.size());
+    std::vector<std::string_view> chunks;
+    chunks.reserve(documents.size());
     for (const auto& doc : documents)
     {
-        chunks_str.push_back(doc.page_content);
+        chunks.push_back(doc.page_content);
     }
 
-    auto embeddings = Chunk::EmbeddingModelBatch(chunks_str, model, batch_size);
-
-    if (embeddings.size() != documents.size())
+    // Pooled rows are written straight into the returned documents
+    std::vector<RAGLibrary::Document> result_docs = documents;
+    for (auto& doc : result_docs)
     {
-        throw RAGLibrary::RagException("Mismatch between number of documents and generated embeddings.");
+        doc.embedding.reset();
     }
+    DocumentSink sink(result_docs);
+    // Pools are per process, so instances with the same options share sessions with the vendor
+    InferencePool::Shared(model, m_options)->Embed(chunks, sink, int(batch_size));
 
-    std::vector<RAGLibrary::Document> result_docs = documents;
-    for (size_t i = 0; i < documents.size(); ++i)
+    for (const auto& doc : result_docs)
     {
-        result_docs[i].embedding = embeddings[i];
+        if (!doc.embedding.has_value() || doc.embedding->size() != sink.Dim())
+        {
+            throw RAGLibrary::RagException("Mismatch between number of documents and generated embeddings.");
+        }
     }
 
     return result_docs;
@@ -2,16 +2,20 @@
 #define EMBEDDING_MODEL_H
 
 #include "Embedding/IBaseEmbedding.h"
+#include "InferencePool.h"
 
 namespace Embedding {
 
     class EmbeddingModel : public IBaseEmbedding
     {
     public:
-        EmbeddingModel() = default;
+        EmbeddingModel(InferenceOptions options = {}) : m_options(options) {}
         virtual ~EmbeddingModel() = default;
 
         std::vector<RAGLibrary::Document> GenerateEmbeddings(const std::vector<RAGLibrary::Document> &documents, const std::string &model, size_t batch_size = 32) override;
+
+    private:
+        InferenceOptions m_options;
     };
 
 } // namespace Embedding
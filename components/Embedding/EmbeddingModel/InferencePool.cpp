@@ -0,0 +1,285 @@
+#include "InferencePool.h"
+#include "BoundedQueue.h"
+#include "Chunk/ChunkCommons/ChunkCommons.h"
+#include "RagException.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+    // Planning estimate used before tokenization; padding itself is exact.
+    constexpr size_t kBytesPerToken = 4;
+    // Rough fp32 activation footprint of one padded token in a BERT-style encoder.
+    constexpr size_t kActivationBytesPerToken = 32 * 1024;
+    constexpr size_t kTokensPerRow = 256;
+
+    size_t EstimateTokens(std::string_view text)
+    {
+        return text.size() / kBytesPerToken + 2;
+    }
+
+    Ort::Value CreateTensorOrt(const Ort::MemoryInfo &info, std::vector<int64_t> &data, std::vector<int64_t> &shape)
+    {
+        return Ort::Value::CreateTensor<int64_t>(info, data.data(), data.size(), shape.data(), shape.size());
+    }
+}
+
+namespace Embedding
+{
+    // The token budget grows with batch_size and is capped by a quarter of the free RAM,
+    // so batches of short chunks hold more rows and batches of long chunks fewer.
+    std::vector<std::vector<size_t>> PlanLengthBuckets(const std::vector<std::string_view> &chunks, const int batch_size)
+    {
+        std::vector<size_t> order(chunks.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                         { return chunks[a].size() < chunks[b].size(); });
+
+        size_t token_budget = size_t(std::max(batch_size, 1)) * kTokensPerRow;
+        auto ram = RAGLibrary::get_ram_info();
+        if (ram.free_bytes > 0)
+        {
+            token_budget = std::min(token_budget, std::max<size_t>(ram.free_bytes / 4 / kActivationBytesPerToken, kTokensPerRow));
+        }
+
+        std::vector<std::vector<size_t>> buckets;
+        std::vector<size_t> current;
+        for (size_t idx : order)
+        {
+            // Sorted ascending, so the newest row sets the padded length of the batch
+            size_t padded = EstimateTokens(chunks[idx]);
+            if (!current.empty() && (current.size() + 1) * padded > token_budget)
+            {
+                buckets.push_back(std::move(current));
+                current.clear();
+            }
+            current.push_back(idx);
+        }
+        if (!current.empty())
+        {
+            buckets.push_back(std::move(current));
+        }
+        return buckets;
+    }
+
+    PaddedBatch BuildPaddedBatch(const LocalModel &local, const std::vector<std::string_view> &chunks, const std::vector<size_t> &rows)
+    {
+        std::vector<std::string> texts;
+        texts.reserve(rows.size());
+        for (size_t idx : rows)
+        {
+            texts.emplace_back(chunks[idx]);
+        }
+        auto encoded = local.EncodeBatch(texts);
+
+        PaddedBatch batch;
+        batch.rows = int64_t(encoded.size());
+        for (const auto &ids : encoded)
+        {
+            batch.seqLen = std::max<int64_t>(batch.seqLen, int64_t(ids.size()));
+        }
+
+        const size_t total = size_t(batch.rows * batch.seqLen);
+        batch.inputIds.assign(total, 0);
+        batch.attentionMask.assign(total, 0);
+        batch.tokenTypeIds.assign(total, 0);
+        batch.lengths.reserve(encoded.size());
+        for (size_t r = 0; r < encoded.size(); ++r)
+        {
+            const size_t offset = r * size_t(batch.seqLen);
+            std::copy(encoded[r].begin(), encoded[r].end(), batch.inputIds.begin() + offset);
+            std::fill_n(batch.attentionMask.begin() + offset, encoded[r].size(), int64_t(1));
+            batch.lengths.push_back(encoded[r].size());
+        }
+        return batch;
+    }
+
+    size_t RunPooled(Ort::Session &session, const LocalModel &local, PaddedBatch &batch, InferenceScratch &scratch,
+                     EmbeddingSink &sink, const std::vector<size_t> &rows)
+    {
+        if (batch.seqLen == 0)
+        {
+            return 0;
+        }
+
+        auto memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        std::vector<int64_t> inputShape{batch.rows, batch.seqLen};
+
+        Ort::IoBinding binding(session);
+        std::vector<Ort::Value> inputTensors;
+        inputTensors.emplace_back(CreateTensorOrt(memoryInfo, batch.inputIds, inputShape));
+        inputTensors.emplace_back(CreateTensorOrt(memoryInfo, batch.attentionMask, inputShape));
+        binding.BindInput("input_ids", inputTensors[0]);
+        binding.BindInput("attention_mask", inputTensors[1]);
+        if (local.HasInput("token_type_ids"))
+        {
+            inputTensors.emplace_back(CreateTensorOrt(memoryInfo, batch.tokenTypeIds, inputShape));
+            binding.BindInput("token_type_ids", inputTensors.back());
+        }
+
+        // With a static hidden size the output is bound to the reused scratch buffer,
+        // so ORT does not allocate a fresh [rows, seq, hidden] tensor per batch
+        const float *hidden = nullptr;
+        size_t dim = 0;
+        std::vector<Ort::Value> outputs;
+        if (local.hiddenSize > 0)
+        {
+            dim = size_t(local.hiddenSize);
+            scratch.hidden.resize(size_t(batch.rows * batch.seqLen) * dim);
+            std::vector<int64_t> outputShape{batch.rows, batch.seqLen, local.hiddenSize};
+            auto output = Ort::Value::CreateTensor<float>(memoryInfo, scratch.hidden.data(), scratch.hidden.size(), outputShape.data(), outputShape.size());
+            binding.BindOutput(local.outputName.c_str(), output);
+            session.Run(Ort::RunOptions(nullptr), binding);
+            hidden = scratch.hidden.data();
+        }
+        else
+        {
+            binding.BindOutput(local.outputName.c_str(), memoryInfo);
+            session.Run(Ort::RunOptions(nullptr), binding);
+            outputs = binding.GetOutputValues();
+            hidden = outputs.front().GetTensorData<float>();
+            dim = outputs.front().GetTensorTypeAndShapeInfo().GetElementCount() / size_t(batch.rows * batch.seqLen);
+        }
+
+        // Pool each row directly into its destination instead of a per-batch copy
+        sink.SetDim(dim);
+        const size_t seqLen = size_t(batch.seqLen);
+        for (size_t r = 0; r < rows.size(); ++r)
+        {
+            const float *tokens = hidden + r * seqLen * dim;
+            float *out = sink.Row(rows[r]);
+            if (local.pooling == Pooling::Cls)
+            {
+                std::copy_n(tokens, dim, out);
+                float norm = std::sqrt(std::inner_product(out, out + dim, out, 0.0f));
+                const float inv = norm > 0.0f ? 1.0f / norm : 0.0f;
+                std::transform(out, out + dim, out, [inv](float v)
+                               { return v * inv; });
+            }
+            else
+            {
+                Chunk::MeanPoolNormalize(tokens, batch.attentionMask.data() + r * seqLen, 1, seqLen, dim, out);
+            }
+        }
+        return dim;
+    }
+
+    InferencePool::InferencePool(const std::string &model, InferenceOptions options)
+        : m_options(ModelRegistry::Resolve(options)), m_local(ModelRegistry::Instance().Get(model))
+    {
+        // Same file as the registry session, so the pool never mixes fp32 and INT8
+        const std::string &modelPath = m_local->path;
+        m_sessions.reserve(m_options.sessions);
+        if (m_local->sessionOptions.intraOpThreads == m_options.intraOpThreads &&
+            m_local->sessionOptions.graphOptimizations == m_options.graphOptimizations)
+        {
+            m_sessions.push_back(m_local->session);
+        }
+        const Ort::SessionOptions sessionOptions = ModelRegistry::MakeSessionOptions(m_options);
+        while (m_sessions.size() < m_options.sessions)
+        {
+            m_sessions.push_back(std::make_shared<Ort::Session>(ModelRegistry::Instance().Env(), modelPath.c_str(), sessionOptions));
+        }
+    }
+
+    InferencePoolPtr InferencePool::Shared(const std::string &model, InferenceOptions options)
+    {
+        options = ModelRegistry::Resolve(options);
+        const std::string key = model + "|" + std::to_string(options.sessions) + "|" +
+                                std::to_string(options.intraOpThreads) + "|" + (options.graphOptimizations ? "1" : "0");
+
+        static std::mutex mtx;
+        static std::map<std::string, InferencePoolPtr> pools;
+        std::scoped_lock lock(mtx);
+        auto &pool = pools[key];
+        if (!pool)
+        {
+            pool = std::make_shared<InferencePool>(model, options);
+        }
+        return pool;
+    }
+
+    void InferencePool::Embed(const std::vector<std::string_view> &chunks, EmbeddingSink &sink, const int batch_size)
+    {
+        struct Work
+        {
+            std::vector<size_t> rows;
+            PaddedBatch batch;
+        };
+
+        if (chunks.empty())
+        {
+            return;
+        }
+
+        auto buckets = PlanLengthBuckets(chunks, batch_size);
+        RAGLibrary::BoundedQueue<Work> queue(m_sessions.size() * 2);
+
+        std::mutex errorMutex;
+        std::exception_ptr error;
+        auto fail = [&](std::exception_ptr e)
+        {
+            {
+                std::lock_guard lock(errorMutex);
+                if (!error)
+                    error = e;
+            }
+            queue.close();
+        };
+
+        // Producer: tokenization and padding of batch i+1 overlap inference of batch i
+        std::thread producer([&]
+                             {
+            try
+            {
+                for (auto &rows : buckets)
+                {
+                    auto batch = BuildPaddedBatch(*m_local, chunks, rows);
+                    if (!queue.push(Work{std::move(rows), std::move(batch)}))
+                        break;
+                }
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+            }
+            queue.close(); });
+
+        // Consumers: one thread per session, each with its own arena
+        std::vector<std::thread> workers;
+        workers.reserve(m_sessions.size());
+        for (auto &session : m_sessions)
+        {
+            workers.emplace_back([&, s = session.get()]
+                                 {
+                InferenceScratch scratch;
+                try
+                {
+                    while (auto work = queue.pop())
+                    {
+                        RunPooled(*s, *m_local, work->batch, scratch, sink, work->rows);
+                    }
+                }
+                catch (...)
+                {
+                    fail(std::current_exception());
+                } });
+        }
+
+        producer.join();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
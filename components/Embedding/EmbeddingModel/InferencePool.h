@@ -0,0 +1,67 @@
+#ifndef INFERENCE_POOL_H
+#define INFERENCE_POOL_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ModelRegistry.h"
+#include "Embedding/EmbeddingSink.h"
+
+namespace Embedding
+{
+    struct PaddedBatch
+    {
+        std::vector<int64_t> inputIds;
+        std::vector<int64_t> attentionMask;
+        std::vector<int64_t> tokenTypeIds;
+        std::vector<size_t> lengths;
+        int64_t rows = 0;
+        int64_t seqLen = 0;
+    };
+
+    // Per-thread buffer reused across batches as the IO-bound hidden-state output.
+    struct InferenceScratch
+    {
+        std::vector<float> hidden;
+    };
+
+    // Groups chunk indices into batches of similar length under a RAM-aware token budget.
+    std::vector<std::vector<size_t>> PlanLengthBuckets(const std::vector<std::string_view> &chunks, const int batch_size);
+    // Tokenizes only the given rows and pads them to their longest sequence.
+    PaddedBatch BuildPaddedBatch(const LocalModel &local, const std::vector<std::string_view> &chunks, const std::vector<size_t> &rows);
+    // Runs one batch and pools each row straight into sink.Row(rows[r]); returns the embedding dim.
+    size_t RunPooled(Ort::Session &session, const LocalModel &local, PaddedBatch &batch, InferenceScratch &scratch,
+                     EmbeddingSink &sink, const std::vector<size_t> &rows);
+
+    /**
+     * N sessions of one local model. Embed() tokenizes batch i+1 on a producer
+     * thread while the sessions run inference on earlier batches. When the
+     * options match the ModelRegistry session, that session is the first
+     * worker, so the model is not loaded an extra time.
+     */
+    class InferencePool
+    {
+    public:
+        InferencePool(const std::string &model, InferenceOptions options = {});
+        ~InferencePool() = default;
+
+        // Process-wide pool per (model, options), shared by EmbeddingModel and the local vendor
+        static std::shared_ptr<InferencePool> Shared(const std::string &model, InferenceOptions options = {});
+
+        // Writes the embedding of chunks[i] to sink.Row(i).
+        void Embed(const std::vector<std::string_view> &chunks, EmbeddingSink &sink, const int batch_size = 32);
+
+        inline const InferenceOptions &Options() const { return m_options; }
+        inline const std::string &Model() const { return m_local->name; }
+
+    private:
+        InferenceOptions m_options;
+        LocalModelPtr m_local;
+        std::vector<std::shared_ptr<Ort::Session>> m_sessions;
+    };
+    using InferencePoolPtr = std::shared_ptr<InferencePool>;
+}
+
+#endif // INFERENCE_POOL_H
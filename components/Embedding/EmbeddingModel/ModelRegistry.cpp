@@ -0,0 +1,195 @@
+#include "ModelRegistry.h"
+#include "FileUtilsLocal.h"
+#include "RagException.h"
+
+#include <cctype>
+#include <thread>
+#include <format>
+
+namespace Embedding
+{
+    std::vector<std::vector<int32_t>> LocalModel::EncodeBatch(const std::vector<std::string> &texts) const
+    {
+        std::lock_guard lock(tokenizerMutex);
+        return tokenizer->EncodeBatch(texts);
+    }
+
+    std::vector<int32_t> LocalModel::Encode(const std::string &text) const
+    {
+        std::lock_guard lock(tokenizerMutex);
+        return tokenizer->Encode(text);
+    }
+
+    ModelRegistry::ModelRegistry()
+        : m_env(std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "Embedding"))
+    {
+    }
+
+    ModelRegistry &ModelRegistry::Instance()
+    {
+        static ModelRegistry inst;
+        return inst;
+    }
+
+    std::string ModelRegistry::ModelPath(const std::string &model)
+    {
+        return RAGLibrary::ResolveOnnxModel(std::format("models/{}/model.onnx", model));
+    }
+
+    std::string ModelRegistry::ResolvedPath(const std::string &model) const
+    {
+        std::shared_future<LocalModelPtr> loaded;
+        {
+            std::scoped_lock lock(m_mutex);
+            auto it = m_models.find(model);
+            if (it != m_models.end())
+                loaded = it->second;
+        }
+        // The file is picked when loading starts, so a load in progress already decided it
+        if (loaded.valid())
+        {
+            try
+            {
+                return loaded.get()->path;
+            }
+            catch (const std::exception &)
+            {
+            }
+        }
+        return ModelPath(model);
+    }
+
+    std::string ModelRegistry::Precision(const std::string &model) const
+    {
+        return ResolvedPath(model).ends_with(".int8.onnx") ? "int8" : "fp32";
+    }
+
+    std::string ModelRegistry::TokenizerPath(const std::string &model)
+    {
+        return std::format("models/{}/tokenizer.json", model);
+    }
+
+    Pooling ModelRegistry::PoolingFor(const std::string &model)
+    {
+        // BGE models are trained on the [CLS] state; the ONNX export carries no pooling config
+        std::string lower = model;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c)
+                       { return std::tolower(c); });
+        return lower.find("bge") != std::string::npos ? Pooling::Cls : Pooling::Mean;
+    }
+
+    InferenceOptions ModelRegistry::Resolve(InferenceOptions options)
+    {
+        options.sessions = std::max<size_t>(options.sessions, 1);
+        if (options.intraOpThreads <= 0)
+        {
+            size_t hw = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+            options.intraOpThreads = int(std::max<size_t>(hw / options.sessions, 1));
+        }
+        return options;
+    }
+
+    Ort::SessionOptions ModelRegistry::MakeSessionOptions(const InferenceOptions &options)
+    {
+        Ort::SessionOptions sessionOptions;
+        sessionOptions.SetIntraOpNumThreads(options.intraOpThreads);
+        sessionOptions.SetInterOpNumThreads(1);
+        sessionOptions.SetGraphOptimizationLevel(options.graphOptimizations ? ORT_ENABLE_ALL : ORT_DISABLE_ALL);
+        sessionOptions.EnableCpuMemArena();
+        sessionOptions.EnableMemPattern();
+        return sessionOptions;
+    }
+
+    LocalModelPtr ModelRegistry::Load(const std::string &model) const
+    {
+        const std::string modelPath = ModelPath(model);
+        const std::string tokenizerPath = TokenizerPath(model);
+
+        auto loaded = std::make_shared<LocalModel>();
+        loaded->name = model;
+        loaded->path = modelPath;
+        loaded->pooling = PoolingFor(model);
+        loaded->sessionOptions = Resolve({});
+        loaded->session = std::make_shared<Ort::Session>(*m_env, modelPath.c_str(), MakeSessionOptions(loaded->sessionOptions));
+        loaded->tokenizer = tokenizers::Tokenizer::FromBlobJSON(RAGLibrary::FileReader(tokenizerPath));
+
+        Ort::AllocatorWithDefaultOptions allocator;
+        for (size_t i = 0; i < loaded->session->GetInputCount(); ++i)
+        {
+            loaded->inputNames.emplace_back(loaded->session->GetInputNameAllocated(i, allocator).get());
+        }
+        // Token-level output: "last_hidden_state" for feature-extraction exports
+        loaded->outputName = loaded->session->GetOutputNameAllocated(0, allocator).get();
+        auto outputShape = loaded->session->GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        if (outputShape.size() == 3 && outputShape[2] > 0)
+        {
+            loaded->hiddenSize = outputShape[2];
+        }
+        return loaded;
+    }
+
+    LocalModelPtr ModelRegistry::Get(const std::string &model)
+    {
+        std::promise<LocalModelPtr> promise;
+        std::shared_future<LocalModelPtr> pending;
+        bool owner = false;
+        {
+            std::scoped_lock lock(m_mutex);
+            auto it = m_models.find(model);
+            if (it != m_models.end())
+            {
+                pending = it->second;
+            }
+            else
+            {
+                pending = promise.get_future().share();
+                m_models.emplace(model, pending);
+                owner = true;
+            }
+        }
+        if (!owner)
+        {
+            return pending.get();
+        }
+
+        // Load outside the lock so other models stay available meanwhile;
+        // concurrent callers of the same model wait on the shared future.
+        try
+        {
+            auto loaded = Load(model);
+            promise.set_value(loaded);
+            return loaded;
+        }
+        catch (...)
+        {
+            promise.set_exception(std::current_exception());
+            std::scoped_lock lock(m_mutex);
+            m_models.erase(model);
+            throw;
+        }
+    }
+
+    void ModelRegistry::Evict(const std::string &model)
+    {
+        std::scoped_lock lock(m_mutex);
+        m_models.erase(model);
+    }
+
+    void ModelRegistry::Clear()
+    {
+        std::scoped_lock lock(m_mutex);
+        m_models.clear();
+    }
+
+    std::vector<std::string> ModelRegistry::List() const
+    {
+        std::scoped_lock lock(m_mutex);
+        std::vector<std::string> names;
+        names.reserve(m_models.size());
+        for (const auto &[name, _] : m_models)
+        {
+            names.push_back(name);
+        }
+        return names;
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include <algorithm>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "onnxruntime/core/session/onnxruntime_cxx_api.h"
+#include "tokenizers_cpp.h"
+
+namespace Embedding
+{
+    /**
+     * A local ONNX model loaded from models/<name>/ together with its tokenizer.
+     * Ort::Session::Run is thread-safe; the tokenizer is not, so every
+     * access to it goes through EncodeBatch/Encode.
+     */
+    enum class Pooling
+    {
+        Mean, // masked mean over tokens (sentence-transformers default)
+        Cls   // first token (BGE)
+    };
+
+    struct InferenceOptions
+    {
+        size_t sessions = 2;              // concurrent ONNX sessions
+        int intraOpThreads = 0;           // per session, 0 → hardware threads / sessions
+        bool graphOptimizations = true;   // ORT_ENABLE_ALL instead of ORT_DISABLE_ALL
+
+        bool operator==(const InferenceOptions &other) const = default;
+    };
+
+    struct LocalModel
+    {
+        std::string name;
+        std::string path; // model.int8.onnx when a quantized export is present
+        // Built with the default InferenceOptions, so it doubles as the first worker of a default InferencePool
+        std::shared_ptr<Ort::Session> session;
+        InferenceOptions sessionOptions;
+        std::vector<std::string> inputNames;
+        std::string outputName;
+        int64_t hiddenSize = -1; // last dim of a [batch, seq, hidden] output; -1 when dynamic
+        Pooling pooling = Pooling::Mean;
+
+        inline bool HasInput(const std::string &input) const
+        {
+            return std::find(inputNames.begin(), inputNames.end(), input) != inputNames.end();
+        }
+
+        std::vector<std::vector<int32_t>> EncodeBatch(const std::vector<std::string> &texts) const;
+        std::vector<int32_t> Encode(const std::string &text) const;
+
+        std::unique_ptr<tokenizers::Tokenizer> tokenizer;
+        mutable std::mutex tokenizerMutex;
+    };
+    using LocalModelPtr = std::shared_ptr<const LocalModel>;
+
+    /**
+     * Process-wide cache of local models. Each model and tokenizer is loaded
+     * once, on first use, and then shared across calls and threads.
+     */
+    class ModelRegistry
+    {
+    public:
+        static ModelRegistry &Instance();
+
+        LocalModelPtr Get(const std::string &model);
+        void Evict(const std::string &model);
+        void Clear();
+        std::vector<std::string> List() const;
+
+        inline Ort::Env &Env() { return *m_env; }
+        static std::string ModelPath(const std::string &model);
+        // File actually serving `model`: the loaded session's once loaded, else ModelPath()
+        std::string ResolvedPath(const std::string &model) const;
+        // "int8" or "fp32", from ResolvedPath()
+        std::string Precision(const std::string &model) const;
+        static std::string TokenizerPath(const std::string &model);
+        static Pooling PoolingFor(const std::string &model);
+        // sessions >= 1 and intraOpThreads resolved against the hardware threads
+        static InferenceOptions Resolve(InferenceOptions options);
+        static Ort::SessionOptions MakeSessionOptions(const InferenceOptions &options);
+
+    private:
+        ModelRegistry();
+        ModelRegistry(const ModelRegistry &) = delete;
+        ModelRegistry &operator=(const ModelRegistry &) = delete;
+
+        LocalModelPtr Load(const std::string &model) const;
+
+        std::unique_ptr<Ort::Env> m_env;
+        mutable std::mutex m_mutex;
+        std::map<std::string, std::shared_future<LocalModelPtr>> m_models;
+    };
+}
+
+#endif // MODEL_REGISTRY_H
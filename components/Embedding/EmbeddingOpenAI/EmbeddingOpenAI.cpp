@@ -1,8 +1,11 @@
 #include "EmbeddingOpenAI.h"
 
 #include <cstddef>
+#include <algorithm>
 #include <iostream>
+#include <numeric>
 #include "RagException.h"
+#include "EmbeddingCache/EmbeddingCache.h"
 #include "openai/openai.hpp"
 
 namespace EmbeddingOpenAI
@@ -13,7 +16,26 @@ namespace EmbeddingOpenAI
         openai::start(m_ApiKey);
     }
 
-        std::vector<RAGLibrary::Document> EmbeddingOpenAI::GenerateEmbeddings(const std::vector<RAGLibrary::Document> &documents, const std::string &model, size_t batch_size)
+    void EmbeddingOpenAI::SetSchedulerOptions(const SchedulerOptions &options)
+    {
+        EmbeddingScheduler::Shared().SetOptions(options);
+    }
+
+    SchedulerOptions EmbeddingOpenAI::GetSchedulerOptions()
+    {
+        return EmbeddingScheduler::Shared().Options();
+    }
+
+    std::vector<RAGLibrary::Document> EmbeddingOpenAI::GenerateEmbeddings(const std::vector<RAGLibrary::Document> &documents, const std::string &model, size_t batch_size)
+    {
+        std::vector<RAGLibrary::Document> processedDocuments = documents;
+        for(auto &doc : processedDocuments)
+            doc.embedding.reset();
+        EmbedMissing(processedDocuments, model, batch_size);
+        return processedDocuments;
+    }
+
+    void EmbeddingOpenAI::EmbedMissing(std::vector<RAGLibrary::Document> &documents, const std::string &model, size_t batch_size)
     {
         if (documents.empty())
             throw RAGLibrary::RagException("No documents provided for embedding.");
@@ -21,58 +43,55 @@ namespace EmbeddingOpenAI
         if (model.empty())
             throw RAGLibrary::RagException("Model name cannot be empty.");
 
-        std::vector<RAGLibrary::Document> processedDocuments = documents;
-        const size_t total = processedDocuments.size();
-        
-        for(size_t i = 0; i < total; i+=batch_size)
+        for(size_t j = 0; j < documents.size(); j++)
         {
-            const size_t end_idx = std::min(i + batch_size, total);
-            std::vector<std::string> batch_texts;
-            batch_texts.reserve(end_idx - i);
-
-            for(size_t j = i; j < end_idx; j++)
-            { 
-                auto& doc = processedDocuments[j];
-                if(doc.page_content.empty()){
-                      throw RAGLibrary::RagException("Document content is empty at index: " + std::to_string(j));
-                }
-                batch_texts.push_back(doc.page_content);
+            if(documents[j].page_content.empty()){
+                  throw RAGLibrary::RagException("Document content is empty at index: " + std::to_string(j));
             }
+        }
 
-            auto response = openai::embedding().create({
-                {"input", batch_texts},
-                {"model", model}
-            });
-            if(response.contains("data") && response["data"].is_array() && !response["data"].empty())
-            {
-                auto& data = response["data"];
-                
-                if(data.size() != batch_texts.size())
-                {
-                    throw RAGLibrary::RagException(
-                        "Mismatch between batch size and response size. Expected: " +
-                        std::to_string(batch_texts.size()) + " Received: " +
-                        std::to_string(data.size()));
-                }
-                for (size_t b = 0; b < data.size(); ++b) 
-                {
-                    const size_t doc_index = i + b;
-                    if (data[b].contains("embedding") && data[b]["embedding"].is_array()) {
-                        processedDocuments[doc_index].embedding = 
-                                data[b]["embedding"].get<std::vector<float>>();
-                    }
-                    else {
-                        throw RAGLibrary::RagException(
-                            "Malformed embedding response for document index: " + 
-                            std::to_string(doc_index));
-                    }
-                }
-            }
-            else
-            {
-                throw RAGLibrary::RagException("API Error: " + response.dump() + "\nBatches indices: " + std::to_string(i) + "-" + std::to_string(end_idx - 1));
-            }
-        }          
-        return processedDocuments;
+        // Only documents without an embedding that are not cached are sent to the API
+        auto cache = ::Embedding::EmbeddingCache::ForModel(model);
+        std::vector<size_t> pending;
+        if(cache)
+            pending = cache->Fill(documents);
+        else
+        {
+            pending.resize(documents.size());
+            std::iota(pending.begin(), pending.end(), size_t(0));
+        }
+        std::erase_if(pending, [&](size_t idx) { return documents[idx].embedding.has_value(); });
+        if(pending.empty())
+            return;
+
+        std::vector<std::string_view> texts;
+        texts.reserve(pending.size());
+        for(size_t idx : pending)
+            texts.push_back(documents[idx].page_content);
+
+        // Each finished batch is checkpointed into documents and the cache immediately
+        ::Embedding::DocumentSink documentSink(documents);
+        ::Embedding::RemappedSink sink(documentSink, pending);
+        EmbedInto(texts, model, sink, batch_size, [&](size_t first, size_t count)
+        {
+            if(cache)
+                cache->Store(documents, std::vector<size_t>(pending.begin() + first, pending.begin() + first + count));
+        });
+    }
+
+    void EmbeddingOpenAI::EmbedInto(const std::vector<std::string_view> &texts, const std::string &model, ::Embedding::EmbeddingSink &sink,
+                                    size_t batch_size, const EmbeddingScheduler::BatchDone &onBatch)
+    {
+        if (model.empty())
+            throw RAGLibrary::RagException("Model name cannot be empty.");
+
+        for(size_t j = 0; j < texts.size(); j++)
+        {
+            if(texts[j].empty())
+                throw RAGLibrary::RagException("Document content is empty at index: " + std::to_string(j));
+        }
+
+        // batch_size (0: no extra cap) limits the inputs per request; the token estimate may split further
+        EmbeddingScheduler::Shared().Run(texts, model, sink, onBatch, m_ApiKey, batch_size);
     }
 }
@@ -2,6 +2,7 @@
 #define EMBEDDING_OPENAI_H
 
 #include "IEmbeddingOpenAI.h"
+#include "EmbeddingScheduler.h"
 
 namespace EmbeddingOpenAI
 {
@@ -13,7 +14,18 @@ namespace EmbeddingOpenAI
         virtual ~EmbeddingOpenAI() = default;
 
         void SetAPIKey(const std::string &apiKey) final;
+        // Concurrency, batch sizing and rate limits of the embeddings requests. Process-wide:
+        // the shared scheduler also serves ChunkDefault, ChunkQuery and the "openai" vendor.
+        static void SetSchedulerOptions(const SchedulerOptions &options);
+        static SchedulerOptions GetSchedulerOptions();
         std::vector<RAGLibrary::Document> GenerateEmbeddings(const std::vector<RAGLibrary::Document> &documents, const std::string &model, size_t batch_size = 32) final;
+        // Embeds, in place, the documents that have no embedding yet. Batches that
+        // completed stay in `documents` when a later batch fails, so calling again resumes.
+        void EmbedMissing(std::vector<RAGLibrary::Document> &documents, const std::string &model, size_t batch_size = 32);
+        // Writes the embedding of texts[i] to sink.Row(i); onBatch is called as each batch lands.
+        // batch_size > 0 caps the inputs per request below SchedulerOptions::maxInputsPerBatch.
+        void EmbedInto(const std::vector<std::string_view> &texts, const std::string &model, ::Embedding::EmbeddingSink &sink,
+                       size_t batch_size = 0, const EmbeddingScheduler::BatchDone &onBatch = {});
 
     private:
         std::string m_ApiKey;
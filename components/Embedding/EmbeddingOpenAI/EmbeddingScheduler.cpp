@@ -0,0 +1,627 @@
+#include "EmbeddingScheduler.h"
+#include "RagException.h"
+#include "StringUtils.h"
+
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+
+namespace
+{
+    size_t WriteCallback(char *data, size_t size, size_t nmemb, void *userp)
+    {
+        static_cast<std::string *>(userp)->append(data, size * nmemb);
+        return size * nmemb;
+    }
+
+    size_t HeaderCallback(char *data, size_t size, size_t nmemb, void *userp)
+    {
+        // Only Retry-After in seconds is used; HTTP-date values are ignored
+        std::string_view line(data, size * nmemb);
+        constexpr std::string_view name = "retry-after:";
+        if (line.size() > name.size() &&
+            std::equal(name.begin(), name.end(), line.begin(), [](char a, char b)
+                       { return a == std::tolower(static_cast<unsigned char>(b)); }))
+        {
+            *static_cast<long *>(userp) = std::atol(std::string(line.substr(name.size())).c_str());
+        }
+        return size * nmemb;
+    }
+
+    // Transient failures worth sending the same batch again.
+    bool IsRetryable(CURLcode code, long status)
+    {
+        if (code != CURLE_OK)
+            return true;
+        return status == 408 || status == 409 || status == 429 || status >= 500;
+    }
+
+    void GlobalInit()
+    {
+        static std::once_flag once;
+        std::call_once(once, []
+                       { curl_global_init(CURL_GLOBAL_DEFAULT); });
+    }
+
+    struct Transfer
+    {
+        CURL *easy = nullptr;
+        curl_slist *headers = nullptr;
+        std::string auth; // Authorization header `headers` was built with
+        size_t batch = 0;
+        std::string body;
+        std::string response;
+        long retryAfter = 0;
+    };
+
+    /**
+     * Walks {"data": [{"index": i, "embedding": <base64 string | float array>}, ...]}
+     * as SAX events, without building a DOM. Embeddings are decoded into a scratch
+     * matrix for the batch; nothing reaches the sink until Commit(), which runs only
+     * once the whole response validated, so a failed batch leaves no partial rows.
+     */
+    class EmbeddingResponseSax : public nlohmann::json_sax<nlohmann::json>
+    {
+    public:
+        explicit EmbeddingResponseSax(size_t count) : m_seen(count, false) {}
+
+        bool null() override { return true; }
+        bool boolean(bool) override { return true; }
+        bool number_integer(number_integer_t val) override { return Number(double(val), val >= 0 ? size_t(val) : SIZE_MAX); }
+        bool number_unsigned(number_unsigned_t val) override { return Number(double(val), size_t(val)); }
+        bool number_float(number_float_t val, const string_t &) override { return Number(val, SIZE_MAX); }
+        bool binary(binary_t &) override { return true; }
+
+        bool string(string_t &val) override
+        {
+            if (!InItem() || m_key != "embedding")
+                return true;
+            const size_t bytes = StringUtils::base64DecodedSize(val);
+            if (bytes == 0 || bytes % sizeof(float) != 0)
+                return Fail("Malformed base64 embedding");
+            const size_t dim = bytes / sizeof(float);
+
+            // OpenAI sends "index" first; otherwise decode aside and place at end_object
+            float *target = nullptr;
+            if (m_index < m_seen.size())
+            {
+                if (!SetDim(dim))
+                    return false;
+                target = m_rows.data() + m_index * m_dim;
+            }
+            else
+            {
+                m_current.resize(dim);
+                target = m_current.data();
+            }
+            if (!StringUtils::base64Decode(val, reinterpret_cast<unsigned char *>(target)))
+                return Fail("Malformed base64 embedding");
+            if constexpr (std::endian::native == std::endian::big)
+            {
+                for (size_t i = 0; i < dim; ++i)
+                    target[i] = std::bit_cast<float>(std::byteswap(std::bit_cast<uint32_t>(target[i])));
+            }
+            m_written = target != m_current.data();
+            m_hasEmbedding = true;
+            return true;
+        }
+
+        bool key(string_t &val) override
+        {
+            if (m_depth == 1)
+                m_rootKey = val;
+            else if (InItem())
+                m_key = val;
+            return true;
+        }
+
+        bool start_object(std::size_t) override
+        {
+            ++m_depth;
+            if (m_inData && m_depth == 3)
+            {
+                m_index = SIZE_MAX;
+                m_key.clear();
+                m_current.clear();
+                m_hasEmbedding = false;
+                m_written = false;
+            }
+            return true;
+        }
+
+        bool end_object() override
+        {
+            if (InItem())
+            {
+                const size_t index = m_index == SIZE_MAX ? m_position : m_index;
+                ++m_position;
+                if (index >= m_seen.size() || m_seen[index] || !m_hasEmbedding)
+                    return Fail("Malformed embedding response for document index: " + std::to_string(index));
+                m_seen[index] = true;
+                if (!m_written)
+                {
+                    if (!SetDim(m_current.size()))
+                        return false;
+                    std::copy(m_current.begin(), m_current.end(), m_rows.begin() + index * m_dim);
+                }
+            }
+            --m_depth;
+            return true;
+        }
+
+        bool start_array(std::size_t) override
+        {
+            ++m_depth;
+            if (m_depth == 2 && m_rootKey == "data")
+                m_inData = true;
+            else if (m_inData && m_depth == 4 && m_key == "embedding")
+                m_hasEmbedding = true; // float array fallback for servers without base64 support
+            return true;
+        }
+
+        bool end_array() override
+        {
+            if (m_inData && m_depth == 2)
+                m_inData = false;
+            --m_depth;
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &ex) override
+        {
+            return Fail(std::string("Malformed JSON in embedding response: ") + ex.what());
+        }
+
+        inline size_t Items() const { return m_position; }
+        inline const std::string &Error() const { return m_error; }
+
+        // Copies the validated batch into sink rows [first, first + count)
+        void Commit(Embedding::EmbeddingSink &sink, size_t first) const
+        {
+            sink.SetDim(m_dim);
+            for (size_t k = 0; k < m_seen.size(); ++k)
+                std::copy_n(m_rows.data() + k * m_dim, m_dim, sink.Row(first + k));
+        }
+
+    private:
+        bool InItem() const { return m_inData && m_depth == 3; }
+
+        bool SetDim(size_t dim)
+        {
+            if (m_dim == 0)
+            {
+                if (dim == 0)
+                    return Fail("Empty embedding in response");
+                m_dim = dim;
+                m_rows.assign(m_seen.size() * dim, 0.0f);
+            }
+            else if (m_dim != dim)
+                return Fail("Inconsistent embedding dimension: expected " + std::to_string(m_dim) + ", got " + std::to_string(dim));
+            return true;
+        }
+
+        bool Number(double val, size_t asIndex)
+        {
+            if (InItem() && m_key == "index")
+                m_index = asIndex;
+            else if (m_inData && m_depth == 4 && m_key == "embedding")
+                m_current.push_back(float(val));
+            return true;
+        }
+
+        bool Fail(std::string message)
+        {
+            m_error = std::move(message);
+            return false;
+        }
+
+        std::vector<bool> m_seen;
+        std::vector<float> m_rows; // [count x m_dim] scratch of the batch
+        std::vector<float> m_current;
+        std::string m_rootKey, m_key, m_error;
+        size_t m_dim = 0;
+        int m_depth = 0;
+        bool m_inData = false;
+        bool m_hasEmbedding = false;
+        bool m_written = false;
+        size_t m_index = SIZE_MAX;
+        size_t m_position = 0;
+    };
+
+    struct MultiDeleter
+    {
+        void operator()(CURLM *m) const { curl_multi_cleanup(m); }
+    };
+
+    // Idle connection sets kept warm between runs
+    constexpr size_t kMaxIdleConnections = 4;
+}
+
+namespace EmbeddingOpenAI
+{
+    RateLimiter::RateLimiter(double perMinute)
+        : m_capacity(perMinute), m_perSecond(perMinute / 60.0), m_level(perMinute), m_last(std::chrono::steady_clock::now())
+    {
+    }
+
+    void RateLimiter::Refill()
+    {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - m_last).count();
+        m_last = now;
+        m_level = std::min(m_capacity, m_level + elapsed * m_perSecond);
+    }
+
+    std::chrono::milliseconds RateLimiter::WaitFor(double cost)
+    {
+        if (m_capacity <= 0)
+            return std::chrono::milliseconds(0);
+        Refill();
+        // A single request larger than the whole budget only waits for a full bucket
+        double needed = std::min(cost, m_capacity) - m_level;
+        if (needed <= 0)
+            return std::chrono::milliseconds(0);
+        return std::chrono::milliseconds(int64_t(needed / m_perSecond * 1000.0) + 1);
+    }
+
+    void RateLimiter::Consume(double cost)
+    {
+        if (m_capacity <= 0)
+            return;
+        Refill();
+        m_level -= std::min(cost, m_capacity);
+    }
+
+    // One multi handle with an easy handle per in-flight slot. Kept across runs, so later
+    // calls reuse the open (HTTP/2 or keep-alive) connections instead of reconnecting.
+    struct EmbeddingScheduler::Connections
+    {
+        std::unique_ptr<CURLM, MultiDeleter> multi;
+        std::vector<Transfer> slots;
+
+        explicit Connections(size_t size) : multi(curl_multi_init()), slots(size)
+        {
+            curl_multi_setopt(multi.get(), CURLMOPT_PIPELINING, long(CURLPIPE_MULTIPLEX));
+            curl_multi_setopt(multi.get(), CURLMOPT_MAX_HOST_CONNECTIONS, long(size));
+        }
+
+        ~Connections()
+        {
+            for (auto &slot : slots)
+            {
+                if (slot.easy)
+                {
+                    curl_multi_remove_handle(multi.get(), slot.easy);
+                    curl_easy_cleanup(slot.easy);
+                }
+                curl_slist_free_all(slot.headers);
+            }
+        }
+    };
+
+    EmbeddingScheduler::EmbeddingScheduler(SchedulerOptions options)
+        : m_options(std::move(options)),
+          m_requestLimiter(m_options.requestsPerMinute),
+          m_tokenLimiter(m_options.tokensPerMinute)
+    {
+    }
+
+    EmbeddingScheduler::~EmbeddingScheduler() = default;
+
+    EmbeddingScheduler &EmbeddingScheduler::Shared()
+    {
+        static EmbeddingScheduler inst;
+        return inst;
+    }
+
+    // Environment fallbacks are resolved per run, so variables set after startup still apply
+    SchedulerOptions EmbeddingScheduler::Normalize(SchedulerOptions options)
+    {
+        if (options.baseUrl.empty())
+        {
+            const char *env = std::getenv("OPENAI_BASE_URL");
+            options.baseUrl = (env && *env) ? env : "https://api.openai.com/v1";
+        }
+        while (!options.baseUrl.empty() && options.baseUrl.back() == '/')
+            options.baseUrl.pop_back();
+        if (options.apiKey.empty())
+        {
+            const char *env = std::getenv("OPENAI_API_KEY");
+            options.apiKey = env ? env : "";
+        }
+        options.maxInFlight = std::max<size_t>(options.maxInFlight, 1);
+        options.maxInputsPerBatch = std::max<size_t>(options.maxInputsPerBatch, 1);
+        options.maxTokensPerBatch = std::max<size_t>(options.maxTokensPerBatch, 1);
+        return options;
+    }
+
+    void EmbeddingScheduler::SetOptions(SchedulerOptions options)
+    {
+        std::scoped_lock lock(m_mutex);
+        m_options = std::move(options);
+        m_requestLimiter = RateLimiter(m_options.requestsPerMinute);
+        m_tokenLimiter = RateLimiter(m_options.tokensPerMinute);
+        // Connection sets of another size are dropped, here or as they come back
+        const size_t slots = std::max<size_t>(m_options.maxInFlight, 1);
+        std::erase_if(m_idle, [&](const std::unique_ptr<Connections> &c)
+                      { return c->slots.size() != slots; });
+    }
+
+    SchedulerOptions EmbeddingScheduler::Options() const
+    {
+        std::scoped_lock lock(m_mutex);
+        return m_options;
+    }
+
+    std::unique_ptr<EmbeddingScheduler::Connections> EmbeddingScheduler::Acquire(size_t slots)
+    {
+        {
+            std::scoped_lock lock(m_mutex);
+            for (auto it = m_idle.rbegin(); it != m_idle.rend(); ++it)
+            {
+                if ((*it)->slots.size() == slots)
+                {
+                    auto connections = std::move(*it);
+                    m_idle.erase(std::next(it).base());
+                    return connections;
+                }
+            }
+        }
+        return std::make_unique<Connections>(slots);
+    }
+
+    void EmbeddingScheduler::Release(std::unique_ptr<Connections> connections)
+    {
+        std::scoped_lock lock(m_mutex);
+        if (connections->slots.size() == std::max<size_t>(m_options.maxInFlight, 1) && m_idle.size() < kMaxIdleConnections)
+            m_idle.push_back(std::move(connections));
+    }
+
+    std::chrono::milliseconds EmbeddingScheduler::Reserve(double tokens)
+    {
+        std::scoped_lock lock(m_mutex);
+        auto wait = std::max(m_requestLimiter.WaitFor(1), m_tokenLimiter.WaitFor(tokens));
+        if (wait.count() == 0)
+        {
+            m_requestLimiter.Consume(1);
+            m_tokenLimiter.Consume(tokens);
+        }
+        return wait;
+    }
+
+    std::chrono::milliseconds EmbeddingScheduler::Backoff(size_t attempt, long baseMs, long maxMs, double unit)
+    {
+        double cap = double(std::max(baseMs, 1L));
+        for (size_t i = 0; i < attempt && cap < double(maxMs); ++i)
+            cap *= 2.0;
+        cap = std::min(cap, double(std::max(maxMs, 1L)));
+        return std::chrono::milliseconds(int64_t(cap * std::clamp(unit, 0.0, 1.0)));
+    }
+
+    size_t EmbeddingScheduler::EstimateTokens(std::string_view text)
+    {
+        // ~4 bytes per token for English BPE; never below one token
+        return std::max<size_t>(text.size() / 4, 1);
+    }
+
+    std::vector<std::pair<size_t, size_t>> EmbeddingScheduler::PlanBatches(const std::vector<std::string_view> &texts, size_t maxInputs, size_t maxTokens)
+    {
+        std::vector<std::pair<size_t, size_t>> batches;
+        size_t first = 0, tokens = 0;
+        for (size_t i = 0; i < texts.size(); ++i)
+        {
+            size_t t = EstimateTokens(texts[i]);
+            if (i > first && (i - first >= maxInputs || tokens + t > maxTokens))
+            {
+                batches.emplace_back(first, i - first);
+                first = i;
+                tokens = 0;
+            }
+            tokens += t;
+        }
+        if (first < texts.size())
+            batches.emplace_back(first, texts.size() - first);
+        return batches;
+    }
+
+    void EmbeddingScheduler::Run(const std::vector<std::string_view> &texts, const std::string &model, Embedding::EmbeddingSink &sink,
+                                 const BatchDone &onBatch, const std::string &apiKey, size_t maxInputs)
+    {
+        if (texts.empty())
+            return;
+
+        GlobalInit();
+        const SchedulerOptions options = Normalize(Options());
+        const size_t inputsPerBatch = maxInputs > 0 ? std::min(options.maxInputsPerBatch, maxInputs) : options.maxInputsPerBatch;
+        auto batches = PlanBatches(texts, inputsPerBatch, options.maxTokensPerBatch);
+        std::vector<size_t> batchTokens(batches.size(), 0);
+        for (size_t b = 0; b < batches.size(); ++b)
+        {
+            for (size_t i = batches[b].first; i < batches[b].first + batches[b].second; ++i)
+                batchTokens[b] += EstimateTokens(texts[i]);
+        }
+
+        // Concurrent runs each take their own connection set; request and token budgets are shared
+        auto connections = Acquire(options.maxInFlight);
+        CURLM *multi = connections->multi.get();
+        std::vector<Transfer *> idle;
+        for (auto &slot : connections->slots)
+            idle.push_back(&slot);
+
+        const std::string url = options.baseUrl + "/embeddings";
+        const std::string auth = "Authorization: Bearer " + (apiKey.empty() ? options.apiKey : apiKey);
+
+        using Clock = std::chrono::steady_clock;
+        std::deque<size_t> ready(batches.size());
+        std::iota(ready.begin(), ready.end(), size_t(0));
+        std::vector<std::pair<Clock::time_point, size_t>> delayed;
+        std::vector<size_t> attempts(batches.size(), 0);
+        std::mt19937_64 rng{std::random_device{}()};
+        std::uniform_real_distribution<double> jitter(0.0, 1.0);
+        std::string failure;
+
+        auto launch = [&](size_t b, Transfer *t)
+        {
+            const auto [first, count] = batches[b];
+            nlohmann::json input = nlohmann::json::array();
+            for (size_t i = first; i < first + count; ++i)
+                input.push_back(texts[i]);
+            t->batch = b;
+            nlohmann::json request{{"input", std::move(input)}, {"model", model}};
+            if (options.base64Transport)
+                request["encoding_format"] = "base64";
+            t->body = request.dump();
+            t->response.clear();
+            t->retryAfter = 0;
+
+            if (!t->easy)
+                t->easy = curl_easy_init();
+            if (!t->headers || t->auth != auth)
+            {
+                curl_slist_free_all(t->headers);
+                t->headers = curl_slist_append(nullptr, "Content-Type: application/json");
+                t->headers = curl_slist_append(t->headers, auth.c_str());
+                t->auth = auth;
+            }
+            curl_easy_setopt(t->easy, CURLOPT_URL, url.c_str());
+            curl_easy_setopt(t->easy, CURLOPT_HTTPHEADER, t->headers);
+            curl_easy_setopt(t->easy, CURLOPT_POSTFIELDS, t->body.c_str());
+            curl_easy_setopt(t->easy, CURLOPT_POSTFIELDSIZE, long(t->body.size()));
+            curl_easy_setopt(t->easy, CURLOPT_WRITEFUNCTION, WriteCallback);
+            curl_easy_setopt(t->easy, CURLOPT_WRITEDATA, &t->response);
+            curl_easy_setopt(t->easy, CURLOPT_HEADERFUNCTION, HeaderCallback);
+            curl_easy_setopt(t->easy, CURLOPT_HEADERDATA, &t->retryAfter);
+            curl_easy_setopt(t->easy, CURLOPT_HTTP_VERSION, long(CURL_HTTP_VERSION_2TLS));
+            curl_easy_setopt(t->easy, CURLOPT_PIPEWAIT, 1L);
+            curl_easy_setopt(t->easy, CURLOPT_TCP_KEEPALIVE, 1L);
+            curl_easy_setopt(t->easy, CURLOPT_TIMEOUT, options.timeoutSeconds);
+            curl_easy_setopt(t->easy, CURLOPT_PRIVATE, t);
+            curl_multi_add_handle(multi, t->easy);
+        };
+
+        // Returns an error message when the batch failed; empty once it was delivered.
+        auto finish = [&](Transfer *t, CURLcode code, long status) -> std::string
+        {
+            const auto [first, count] = batches[t->batch];
+            const std::string range = "Batches indices: " + std::to_string(first) + "-" + std::to_string(first + count - 1);
+            if (code != CURLE_OK)
+                return "Embedding request failed (" + std::string(curl_easy_strerror(code)) + "). " + range;
+            if (status != 200)
+                return "API Error (HTTP " + std::to_string(status) + "): " + t->response + "\n" + range;
+
+            EmbeddingResponseSax sax(count);
+            try
+            {
+                if (!nlohmann::json::sax_parse(t->response, &sax))
+                    return (sax.Error().empty() ? std::string("Malformed JSON in embedding response.") : sax.Error()) + " " + range;
+                if (sax.Items() != count)
+                    return "Mismatch between batch size and response size. " + range;
+                sax.Commit(sink, first);
+            }
+            catch (const std::runtime_error &e)
+            {
+                return std::string(e.what()) + ". " + range;
+            }
+            if (onBatch)
+                onBatch(first, count);
+            return {};
+        };
+
+        // If anything below throws, the connection set is destroyed with its transfers attached
+        size_t inFlight = 0;
+        while (inFlight > 0 || (failure.empty() && (!ready.empty() || !delayed.empty())))
+        {
+            // Batches whose backoff elapsed go ahead of untouched ones
+            auto now = Clock::now();
+            Clock::time_point nextRetry = Clock::time_point::max();
+            for (auto it = delayed.begin(); it != delayed.end();)
+            {
+                if (it->first <= now)
+                {
+                    ready.push_front(it->second);
+                    it = delayed.erase(it);
+                }
+                else
+                {
+                    nextRetry = std::min(nextRetry, it->first);
+                    ++it;
+                }
+            }
+
+            std::chrono::milliseconds wait(0);
+            while (failure.empty() && !ready.empty() && !idle.empty())
+            {
+                const size_t b = ready.front();
+                wait = Reserve(double(batchTokens[b]));
+                if (wait.count() > 0)
+                    break;
+                ready.pop_front();
+                launch(b, idle.back());
+                idle.pop_back();
+                ++inFlight;
+            }
+            if (ready.empty() && !delayed.empty())
+            {
+                wait = std::chrono::duration_cast<std::chrono::milliseconds>(nextRetry - now) + std::chrono::milliseconds(1);
+            }
+
+            if (inFlight == 0)
+            {
+                if (failure.empty())
+                    std::this_thread::sleep_for(wait);
+                continue;
+            }
+
+            int running = 0;
+            curl_multi_perform(multi, &running);
+            int pending = 0;
+            while (CURLMsg *msg = curl_multi_info_read(multi, &pending))
+            {
+                if (msg->msg != CURLMSG_DONE)
+                    continue;
+                Transfer *t = nullptr;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &t);
+                CURLcode code = msg->data.result;
+                long status = 0;
+                curl_easy_getinfo(t->easy, CURLINFO_RESPONSE_CODE, &status);
+                curl_multi_remove_handle(multi, t->easy);
+                --inFlight;
+                idle.push_back(t);
+
+                std::string error = finish(t, code, status);
+                if (error.empty())
+                    continue;
+                const size_t b = t->batch;
+                if (!IsRetryable(code, status) || attempts[b] >= options.maxRetries)
+                {
+                    if (failure.empty())
+                        failure = error + " (after " + std::to_string(attempts[b] + 1) + " attempts)";
+                    continue;
+                }
+                auto delay = Backoff(attempts[b]++, options.backoffBaseMs, options.backoffMaxMs, jitter(rng));
+                if (t->retryAfter > 0)
+                    delay = std::max<std::chrono::milliseconds>(delay, std::chrono::seconds(t->retryAfter));
+                std::cerr << "[EmbeddingScheduler] " << error << " - retry " << attempts[b] << "/" << options.maxRetries
+                          << " in " << delay.count() << " ms\n";
+                delayed.emplace_back(Clock::now() + delay, b);
+            }
+
+            int timeout = wait.count() > 0 ? int(std::min<int64_t>(wait.count(), 100)) : 100;
+            curl_multi_poll(multi, nullptr, 0, timeout, nullptr);
+        }
+        Release(std::move(connections));
+        if (!failure.empty())
+            throw RAGLibrary::RagException(failure);
+    }
+}
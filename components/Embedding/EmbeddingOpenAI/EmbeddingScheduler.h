@@ -0,0 +1,115 @@
+#ifndef EMBEDDING_SCHEDULER_H
+#define EMBEDDING_SCHEDULER_H
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Embedding/EmbeddingSink.h"
+
+namespace EmbeddingOpenAI
+{
+    struct SchedulerOptions
+    {
+        std::string baseUrl;                 // "" → $OPENAI_BASE_URL or https://api.openai.com/v1
+        std::string apiKey;                  // "" → $OPENAI_API_KEY
+        size_t maxInFlight = 4;              // concurrent requests over the shared connection pool
+        size_t maxInputsPerBatch = 256;      // inputs per request
+        size_t maxTokensPerBatch = 64000;    // estimated tokens per request
+        double requestsPerMinute = 3000;     // 0 → unlimited
+        double tokensPerMinute = 1000000;    // 0 → unlimited
+        long timeoutSeconds = 60;
+        size_t maxRetries = 5;               // per batch, for network errors, 408/409/429 and 5xx
+        long backoffBaseMs = 500;            // first retry waits up to this, doubling per attempt
+        long backoffMaxMs = 30000;
+        bool base64Transport = true;         // request encoding_format=base64 (~4x fewer bytes than float text)
+    };
+
+    /**
+     * Token-bucket limiter: holds up to one minute of budget and refills
+     * continuously at `perMinute`.
+     */
+    class RateLimiter
+    {
+    public:
+        explicit RateLimiter(double perMinute);
+        // Time to wait before `cost` units are available (zero when they are).
+        std::chrono::milliseconds WaitFor(double cost);
+        void Consume(double cost);
+
+    private:
+        void Refill();
+
+        double m_capacity;
+        double m_perSecond;
+        double m_level;
+        std::chrono::steady_clock::time_point m_last;
+    };
+
+    /**
+     * Sends embedding requests for many texts with several batches in flight
+     * through one curl multi handle, so connections (HTTP/2 or keep-alive)
+     * are reused. Batches are sized by estimated token count and launched
+     * within the configured requests/min and tokens/min budget.
+     *
+     * The multi handle and its connections outlive a Run and are reused by the
+     * next one; concurrent runs each take their own set but draw on the same
+     * rate budget. Shared() is the process-wide instance behind EmbeddingOpenAI
+     * and the "openai" vendor, so its options apply to every embedding call.
+     *
+     * A failed batch is retried on its own with exponential backoff and full
+     * jitter (or after the server's Retry-After) while the other batches keep
+     * going. When a batch exhausts its retries no new batches are launched,
+     * the ones in flight are still delivered, and then Run throws.
+     */
+    class EmbeddingScheduler
+    {
+    public:
+        // Called as each batch finishes, once rows [first, first + count) are in the sink.
+        using BatchDone = std::function<void(size_t first, size_t count)>;
+
+        explicit EmbeddingScheduler(SchedulerOptions options = {});
+        ~EmbeddingScheduler();
+        EmbeddingScheduler(const EmbeddingScheduler &) = delete;
+        EmbeddingScheduler &operator=(const EmbeddingScheduler &) = delete;
+
+        static EmbeddingScheduler &Shared();
+
+        // Writes the embedding of texts[i] to sink.Row(i). Batches finish out of
+        // order; onBatch runs on the calling thread. A non-empty apiKey overrides the
+        // options' key and maxInputs > 0 further caps the inputs per request.
+        void Run(const std::vector<std::string_view> &texts, const std::string &model, Embedding::EmbeddingSink &sink,
+                 const BatchDone &onBatch = {}, const std::string &apiKey = "", size_t maxInputs = 0);
+
+        // Full jitter: uniform in [0, min(backoffMaxMs, backoffBaseMs * 2^attempt)].
+        static std::chrono::milliseconds Backoff(size_t attempt, long baseMs, long maxMs, double unit);
+        static size_t EstimateTokens(std::string_view text);
+        static std::vector<std::pair<size_t, size_t>> PlanBatches(const std::vector<std::string_view> &texts, size_t maxInputs, size_t maxTokens);
+
+        // Applies to runs started afterwards and resets the rate budgets.
+        void SetOptions(SchedulerOptions options);
+        SchedulerOptions Options() const;
+
+    private:
+        struct Connections;
+
+        static SchedulerOptions Normalize(SchedulerOptions options);
+        std::unique_ptr<Connections> Acquire(size_t slots);
+        void Release(std::unique_ptr<Connections> connections);
+        // Takes one request and `tokens` from the budgets, or returns how long to wait first
+        std::chrono::milliseconds Reserve(double tokens);
+
+        mutable std::mutex m_mutex;
+        SchedulerOptions m_options;
+        RateLimiter m_requestLimiter;
+        RateLimiter m_tokenLimiter;
+        std::vector<std::unique_ptr<Connections>> m_idle;
+    };
+}
+
+#endif // EMBEDDING_SCHEDULER_H
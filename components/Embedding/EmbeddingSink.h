@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CommonStructs.h"
+
+namespace Embedding
+{
+    /**
+     * Destination of embedding rows. Providers call SetDim() as soon as the
+     * dimension is known and then write each row straight into Row(i), so no
+     * per-document vectors are materialized in between. SetDim() and Row() may
+     * be called from several threads, for distinct rows.
+     */
+    class EmbeddingSink
+    {
+    public:
+        virtual ~EmbeddingSink() = default;
+
+        // Fixes the row dimension (allocating storage) on the first call; later calls must agree.
+        void SetDim(size_t dim)
+        {
+            size_t current = m_dim.load(std::memory_order_acquire);
+            if (current == 0)
+            {
+                std::scoped_lock lock(m_mutex);
+                current = m_dim.load(std::memory_order_relaxed);
+                if (current == 0)
+                {
+                    Allocate(dim);
+                    m_dim.store(dim, std::memory_order_release);
+                    return;
+                }
+            }
+            if (current != dim)
+                throw std::runtime_error("Inconsistent embedding dimension: expected " + std::to_string(current) + ", got " + std::to_string(dim));
+        }
+
+        inline size_t Dim() const { return m_dim.load(std::memory_order_acquire); }
+
+        // Storage of row `index` (Dim() floats); only valid after SetDim().
+        virtual float *Row(size_t index) = 0;
+
+    protected:
+        virtual void Allocate(size_t dim) { (void)dim; }
+
+    private:
+        std::atomic<size_t> m_dim{0};
+        std::mutex m_mutex;
+    };
+
+    // Row-major [rows x dim] matrix, sized once the dimension is known (e.g. vdb_data::flatVD).
+    class MatrixSink : public EmbeddingSink
+    {
+    public:
+        MatrixSink(std::vector<float> &matrix, size_t rows) : m_matrix(matrix), m_rows(rows) {}
+
+        float *Row(size_t index) override { return m_matrix.data() + index * Dim(); }
+
+    protected:
+        void Allocate(size_t dim) override { m_matrix.assign(m_rows * dim, 0.0f); }
+
+    private:
+        std::vector<float> &m_matrix;
+        size_t m_rows;
+    };
+
+    // Writes row i into documents[i].embedding.
+    class DocumentSink : public EmbeddingSink
+    {
+    public:
+        explicit DocumentSink(std::vector<RAGLibrary::Document> &documents) : m_documents(documents) {}
+
+        float *Row(size_t index) override
+        {
+            auto &embedding = m_documents[index].embedding;
+            if (!embedding || embedding->size() != Dim())
+                embedding.emplace(Dim());
+            return embedding->data();
+        }
+
+    private:
+        std::vector<RAGLibrary::Document> &m_documents;
+    };
+
+    // Maps row i onto row rows[i] of another sink, e.g. cache misses onto the full matrix.
+    class RemappedSink : public EmbeddingSink
+    {
+    public:
+        RemappedSink(EmbeddingSink &inner, const std::vector<size_t> &rows) : m_inner(inner), m_rows(rows) {}
+
+        float *Row(size_t index) override { return m_inner.Row(m_rows[index]); }
+
+    protected:
+        void Allocate(size_t dim) override { m_inner.SetDim(dim); }
+
+    private:
+        EmbeddingSink &m_inner;
+        const std::vector<size_t> &m_rows;
+    };
+}
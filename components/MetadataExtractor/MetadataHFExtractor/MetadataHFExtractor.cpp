@@ -35,19 +35,22 @@ namespace MetadataHFExtractor
     {
         m_env = std::make_shared<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "NER");
         m_sessionOptions.SetInterOpNumThreads(1);
+        m_sessionOptions.SetGraphOptimizationLevel(ORT_ENABLE_ALL);
 
+        // Prefer the dynamically quantized INT8 export when it is present
+        const std::string resolvedPath = RAGLibrary::ResolveOnnxModel(modelPath);
         #ifdef _WIN32
-        std::wstring wpath = to_wstring_utf16(modelPath);
+        std::wstring wpath = to_wstring_utf16(resolvedPath);
         m_session = std::make_shared<Ort::Session>(*m_env, wpath.c_str(), m_sessionOptions);
         #else
-        m_session = std::make_shared<Ort::Session>(*m_env, modelPath.c_str(), m_sessionOptions);
+        m_session = std::make_shared<Ort::Session>(*m_env, resolvedPath.c_str(), m_sessionOptions);
         #endif
 
         auto blob = RAGLibrary::FileReader(tokenizerPath);
         m_tokenizer = tokenizers::Tokenizer::FromBlobJSON(blob);
         ReadingFromLabelMap(labelMapPath);
 
-        std::cout << "Model loaded successfully!" << std::endl;
+        std::cout << "Model loaded successfully! (" << resolvedPath << ")" << std::endl;
     }
 
     std::vector<std::pair<std::string, std::string>> MetadataHFExtractor::ExtractMetadata(const std::vector<std::string> &text)
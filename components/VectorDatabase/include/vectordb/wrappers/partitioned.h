@@ -0,0 +1,79 @@
+#pragma once
+/**
+ * PartitionedBackend
+ * ------------------
+ * Splits one logical collection into independent sub-indexes, one per
+ * value of a chosen metadata field (tenant, source, ...).
+ *
+ *  • insert() routes every document to the sub-index of its partition
+ *    value; sub-indexes are created lazily through the factory.
+ *  • query() with a filter on the partition key touches only that
+ *    sub-index (partition pruning); the key is removed from the filter
+ *    forwarded to the sub-backend.
+ *  • query() without the key fans out to every partition and merges
+ *    the top-k.
+ *
+ * Registered as "partitioned":
+ *   { "dim": 768, "partition_key": "tenant",
+ *     "backend": "redis", "backend_cfg": { ... } }
+ * Every sub-backend gets "backend_cfg" with "index" and "prefix"
+ * suffixed by the partition value.
+ */
+#include <functional>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "vectordb/backend.h"
+#include "CommonStructs.h"
+
+namespace vdb::wrappers {
+
+class PartitionedBackend final : public VectorBackend {
+public:
+    using Factory = std::function<VectorBackendPtr(const std::string& partition)>;
+
+    /**
+     * @param dim             Embedding dimension shared by all partitions
+     * @param partitionKey    Metadata field used to route documents
+     * @param factory         Creates the sub-backend of a new partition
+     * @param ascendingScores True when lower scores are better (distances)
+     */
+    PartitionedBackend(std::uint32_t dim,
+                       std::string   partitionKey,
+                       Factory       factory,
+                       bool          ascendingScores = true);
+
+    explicit PartitionedBackend(const nlohmann::json& cfg);
+
+    [[nodiscard]] bool is_open() const noexcept override;
+    void insert(std::span<const RAGLibrary::Document> docs) override;
+
+    std::vector<QueryResult>
+    query(std::span<const float>               embedding,
+          std::size_t                         k,
+          const std::unordered_map<std::string, std::string>* filter = nullptr) override;
+
+    void close() override;
+
+    [[nodiscard]] const std::string& partition_key() const noexcept { return key_; }
+    [[nodiscard]] std::vector<std::string> partitions() const;
+
+private:
+    VectorBackendPtr partition_for(const std::string& value);
+    VectorBackendPtr find_partition(const std::string& value) const;
+
+    std::string                              key_;
+    Factory                                  factory_;
+    bool                                     ascending_;
+    bool                                     open_ = true;
+    mutable std::mutex                       mtx_;
+    std::map<std::string, VectorBackendPtr> parts_;
+};
+
+}  // namespace vdb::wrappers
@@ -13,6 +13,10 @@ namespace py = pybind11;
 namespace vdb
 {
     void force_link_redis_backend();
+    namespace wrappers
+    {
+        void force_link_partitioned_backend();
+    }
 }
 
 using vdb::QueryResult;
@@ -36,6 +40,7 @@ static std::vector<float> to_vecf(const py::handle &obj)
 void bind_VectorDB(py::module_ &m)
 {
     vdb::force_link_redis_backend();
+    vdb::wrappers::force_link_partitioned_backend();
 
     py::class_<QueryResult>(m, "QueryResult")
         .def_readonly("doc", &QueryResult::doc)
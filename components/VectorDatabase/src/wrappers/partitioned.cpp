@@ -0,0 +1,162 @@
+#include "vectordb/wrappers/partitioned.h"
+#include "vectordb/exceptions.h"
+#include "vectordb/registry.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "CommonStructs.h"
+
+namespace vdb::wrappers {
+
+PartitionedBackend::PartitionedBackend(std::uint32_t dim,
+                                       std::string   partitionKey,
+                                       Factory       factory,
+                                       bool          ascendingScores)
+    : VectorBackend(dim)
+    , key_(std::move(partitionKey))
+    , factory_(std::move(factory))
+    , ascending_(ascendingScores)
+{
+    if (key_.empty())
+        throw InvalidConfiguration("partition_key must not be empty");
+    if (!factory_)
+        throw InvalidConfiguration("partition factory must be set");
+}
+
+PartitionedBackend::PartitionedBackend(const nlohmann::json& cfg)
+    : PartitionedBackend(
+          cfg.at("dim").get<std::uint32_t>(),
+          cfg.at("partition_key").get<std::string>(),
+          [name = cfg.at("backend").get<std::string>(),
+           base = cfg.value("backend_cfg", nlohmann::json::object()),
+           dim  = cfg.at("dim").get<std::uint32_t>()](const std::string& p) {
+              /* the trailing ':' keeps "t1" from matching keys of "t10" */
+              nlohmann::json sub = base;
+              sub["dim"]    = dim;
+              sub["index"]  = base.value("index",  "vstore_idx") + "_" + p;
+              sub["prefix"] = base.value("prefix", "doc") + ":" + p + ":";
+              return Registry::instance().make(name, sub);
+          },
+          cfg.value("ascending_scores", true)) {}
+
+bool PartitionedBackend::is_open() const noexcept {
+    std::scoped_lock g(mtx_);
+    return open_;
+}
+
+VectorBackendPtr PartitionedBackend::partition_for(const std::string& value) {
+    std::scoped_lock g(mtx_);
+    if (!open_) throw BackendClosed("Partitioned backend closed");
+
+    auto it = parts_.find(value);
+    if (it != parts_.end()) return it->second;
+
+    auto sub = factory_(value);
+    if (!sub || sub->dim() != dim_)
+        throw InvalidConfiguration("partition '" + value + "' has an invalid sub-backend");
+    return parts_.emplace(value, std::move(sub)).first->second;
+}
+
+VectorBackendPtr PartitionedBackend::find_partition(const std::string& value) const {
+    std::scoped_lock g(mtx_);
+    if (!open_) throw BackendClosed("Partitioned backend closed");
+
+    auto it = parts_.find(value);
+    return it == parts_.end() ? nullptr : it->second;
+}
+
+std::vector<std::string> PartitionedBackend::partitions() const {
+    std::scoped_lock g(mtx_);
+    std::vector<std::string> keys;
+    keys.reserve(parts_.size());
+    for (const auto& [k, _] : parts_) keys.push_back(k);
+    return keys;
+}
+
+void PartitionedBackend::insert(std::span<const RAGLibrary::Document> docs) {
+    if (docs.empty()) return;
+
+    auto value_of = [&](const RAGLibrary::Document& d) -> const std::string& {
+        auto it = d.metadata.find(key_);
+        if (it == d.metadata.end())
+            throw InsertionError("Document missing partition key '" + key_ + "'");
+        return it->second;
+    };
+
+    /* fast path: the whole batch belongs to one partition, no copies */
+    const std::string& first = value_of(docs.front());
+    bool single = std::all_of(docs.begin(), docs.end(),
+                              [&](const RAGLibrary::Document& d) { return value_of(d) == first; });
+    if (single) {
+        partition_for(first)->insert(docs);
+        return;
+    }
+
+    std::map<std::string, std::vector<RAGLibrary::Document>> groups;
+    for (const auto& d : docs) groups[value_of(d)].push_back(d);
+    for (const auto& [value, group] : groups) partition_for(value)->insert(group);
+}
+
+std::vector<QueryResult>
+PartitionedBackend::query(std::span<const float>               emb,
+                          std::size_t                         k,
+                          const std::unordered_map<std::string, std::string>* filter) {
+    if (emb.size() != dim_)
+        throw DimensionMismatch("Dimension mismatch on query");
+
+    /* partition pruning: only the matching sub-index is searched */
+    if (filter) {
+        auto it = filter->find(key_);
+        if (it != filter->end()) {
+            auto sub = find_partition(it->second);
+            if (!sub) return {};
+
+            std::unordered_map<std::string, std::string> rest = *filter;
+            rest.erase(key_);
+            return sub->query(emb, k, rest.empty() ? nullptr : &rest);
+        }
+    }
+
+    std::vector<VectorBackendPtr> subs;
+    {
+        std::scoped_lock g(mtx_);
+        if (!open_) throw BackendClosed("Partitioned backend closed");
+        subs.reserve(parts_.size());
+        for (const auto& [_, b] : parts_) subs.push_back(b);
+    }
+
+    std::vector<QueryResult> merged;
+    for (const auto& sub : subs) {
+        auto hits = sub->query(emb, k, filter);
+        merged.insert(merged.end(),
+                      std::make_move_iterator(hits.begin()),
+                      std::make_move_iterator(hits.end()));
+    }
+
+    auto better = [asc = ascending_](const QueryResult& a, const QueryResult& b) {
+        return asc ? a.score < b.score : a.score > b.score;
+    };
+    if (merged.size() > k) {
+        std::partial_sort(merged.begin(), merged.begin() + k, merged.end(), better);
+        merged.resize(k);
+    } else {
+        std::sort(merged.begin(), merged.end(), better);
+    }
+    return merged;
+}
+
+void PartitionedBackend::close() {
+    std::scoped_lock g(mtx_);
+    for (auto& [_, b] : parts_) b->close();
+    parts_.clear();
+    open_ = false;
+}
+
+static AutoRegister<PartitionedBackend> _auto_register_partitioned("partitioned");
+
+void force_link_partitioned_backend() {
+    (void)_auto_register_partitioned;
+}
+
+}  // namespace vdb::wrappers
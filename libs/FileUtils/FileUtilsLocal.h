@@ -11,6 +11,7 @@
 #include <format>
 #include <iostream>
 #include <filesystem>
+#include <cstdlib>
 
 #include "RagException.h"
 
@@ -34,5 +35,25 @@ namespace RAGLibrary
         }
     }
 
+    /**
+     * Returns the INT8 sibling of an ONNX model (model.onnx → model.int8.onnx)
+     * when it exists, otherwise the path itself. Set PURECPP_ONNX_PRECISION=fp32
+     * to always load the fp32 model.
+     */
+    static std::string ResolveOnnxModel(const std::string &modelPath)
+    {
+        const char *precision = std::getenv("PURECPP_ONNX_PRECISION");
+        if (precision && std::string(precision) == "fp32")
+            return modelPath;
+
+        std::filesystem::path path(modelPath);
+        if (path.extension() != ".onnx")
+            return modelPath;
+        auto quantized = path;
+        quantized.replace_extension(".int8.onnx");
+        std::error_code ec;
+        return std::filesystem::exists(quantized, ec) ? quantized.string() : modelPath;
+    }
+
 }
 #endif
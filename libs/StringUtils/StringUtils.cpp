@@ -2,10 +2,16 @@
 
 #include <re2/re2.h>
 
+#include <array>
+#include <cstdint>
 #include <numeric>
 #include <regex>
 #include <unordered_map>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 using namespace StringUtils;
 
 std::string StringUtils::escapeRegex(const std::string &str)
@@ -79,4 +85,122 @@ std::string StringUtils::removeAccents(const std::string &input)
     }
 
     return result;
-}
\ No newline at end of file
+}
+namespace
+{
+    // Symbol value for each input byte; 0xFF marks bytes outside the alphabet
+    constexpr std::array<uint8_t, 256> kBase64Values = []
+    {
+        std::array<uint8_t, 256> table{};
+        table.fill(0xFF);
+        constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (size_t i = 0; i < alphabet.size(); ++i)
+            table[static_cast<unsigned char>(alphabet[i])] = uint8_t(i);
+        return table;
+    }();
+
+#if defined(__AVX2__)
+    // Muła/Lemire: validate and translate 32 symbols with nibble lookups, then pack
+    // the 6-bit values into 24 bytes. Stops at the first block with an invalid byte.
+    size_t Base64DecodeAVX2(const char *input, size_t blocks, unsigned char *output)
+    {
+        const __m256i lutLo = _mm256_setr_epi8(
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+        const __m256i lutHi = _mm256_setr_epi8(
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+        const __m256i lutRoll = _mm256_setr_epi8(
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m256i mask2F = _mm256_set1_epi8(0x2F);
+        const __m256i packShuffle = _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        const __m256i packLanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+        size_t done = 0;
+        for (; done < blocks; ++done)
+        {
+            __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + done * 32));
+            const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask2F);
+            const __m256i loNibbles = _mm256_and_si256(str, mask2F);
+            const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+            const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+            if (!_mm256_testz_si256(lo, hi))
+                break;
+            const __m256i eq2F = _mm256_cmpeq_epi8(str, mask2F);
+            str = _mm256_add_epi8(str, _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles)));
+
+            const __m256i mergedPairs = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+            __m256i out = _mm256_madd_epi16(mergedPairs, _mm256_set1_epi32(0x00011000));
+            out = _mm256_shuffle_epi8(out, packShuffle);
+            out = _mm256_permutevar8x32_epi32(out, packLanes);
+            // Writes 32 bytes of which 24 are valid; the caller keeps 8 bytes of slack
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + done * 24), out);
+        }
+        return done;
+    }
+#endif
+}
+
+std::size_t StringUtils::base64DecodedSize(std::string_view input)
+{
+    if (input.empty() || input.size() % 4 != 0)
+        return 0;
+    size_t padding = (input.back() == '=') + (input.size() > 1 && input[input.size() - 2] == '=');
+    return input.size() / 4 * 3 - padding;
+}
+
+bool StringUtils::base64Decode(std::string_view input, unsigned char *output)
+{
+    if (input.empty())
+        return true;
+    if (input.size() % 4 != 0)
+        return false;
+
+    // The last quad may carry padding and is always decoded by the scalar tail
+    const size_t body = input.size() - 4;
+    size_t in = 0, out = 0;
+
+#if defined(__AVX2__)
+    if (body >= 64)
+    {
+        const size_t blocks = (body - 32) / 32; // leaves >= 8 output bytes of slack for the last store
+        const size_t done = Base64DecodeAVX2(input.data(), blocks, output);
+        in = done * 32;
+        out = done * 24;
+    }
+#endif
+
+    const auto *src = reinterpret_cast<const unsigned char *>(input.data());
+    for (; in < body; in += 4, out += 3)
+    {
+        const uint32_t a = kBase64Values[src[in]], b = kBase64Values[src[in + 1]];
+        const uint32_t c = kBase64Values[src[in + 2]], d = kBase64Values[src[in + 3]];
+        if ((a | b | c | d) & 0x80)
+            return false;
+        const uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        output[out] = uint8_t(v >> 16);
+        output[out + 1] = uint8_t(v >> 8);
+        output[out + 2] = uint8_t(v);
+    }
+
+    const uint32_t a = kBase64Values[src[in]], b = kBase64Values[src[in + 1]];
+    if ((a | b) & 0x80)
+        return false;
+    output[out++] = uint8_t((a << 2) | (b >> 4));
+    if (src[in + 2] == '=')
+        return src[in + 3] == '=';
+    const uint32_t c = kBase64Values[src[in + 2]];
+    if (c & 0x80)
+        return false;
+    output[out++] = uint8_t((b << 4) | (c >> 2));
+    if (src[in + 3] == '=')
+        return true;
+    const uint32_t d = kBase64Values[src[in + 3]];
+    if (d & 0x80)
+        return false;
+    output[out] = uint8_t((c << 6) | d);
+    return true;
+}
@@ -3,6 +3,7 @@
 
 #include <any>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace StringUtils 
@@ -20,5 +21,12 @@ namespace StringUtils
     std::string str_details(const std::string& text);
 
     std::string removeAccents(const std::string &input);
+
+    // Number of bytes encoded by a padded base64 string; 0 if its length is not a multiple of 4.
+    std::size_t base64DecodedSize(std::string_view input);
+
+    // Decodes padded standard base64 into output, which must hold base64DecodedSize(input) bytes.
+    // Returns false on invalid input. Uses AVX2 when the build targets it.
+    bool base64Decode(std::string_view input, unsigned char *output);
 }
 #endif
@@ -0,0 +1,79 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <queue>
+
+namespace RAGLibrary
+{
+    /**
+     * Blocking multi-producer/multi-consumer queue with a fixed capacity.
+     * push() waits while the queue is full, pop() waits while it is empty.
+     * After close(), push() fails and pop() drains what is left, then
+     * returns std::nullopt.
+     */
+    template <typename Type>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(std::size_t capacity) : m_capacity(capacity ? capacity : 1) {}
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        bool push(Type value)
+        {
+            std::unique_lock lock(m_mutex);
+            m_notFull.wait(lock, [this]
+                           { return m_closed || m_queue.size() < m_capacity; });
+            if (m_closed)
+            {
+                return false;
+            }
+            m_queue.push(std::move(value));
+            m_notEmpty.notify_one();
+            return true;
+        }
+
+        std::optional<Type> pop()
+        {
+            std::unique_lock lock(m_mutex);
+            m_notEmpty.wait(lock, [this]
+                            { return m_closed || !m_queue.empty(); });
+            if (m_queue.empty())
+            {
+                return std::nullopt;
+            }
+            Type value = std::move(m_queue.front());
+            m_queue.pop();
+            m_notFull.notify_one();
+            return value;
+        }
+
+        void close()
+        {
+            std::lock_guard lock(m_mutex);
+            m_closed = true;
+            m_notEmpty.notify_all();
+            m_notFull.notify_all();
+        }
+
+        std::size_t size() const
+        {
+            std::lock_guard lock(m_mutex);
+            return m_queue.size();
+        }
+
+    private:
+        const std::size_t m_capacity;
+        bool m_closed = false;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_notEmpty;
+        std::condition_variable m_notFull;
+        std::queue<Type> m_queue;
+    };
+}
+#endif
@@ -0,0 +1,117 @@
+# Compares the fp32 export (model.onnx) of a local model with its INT8 copy (model.int8.onnx).
+# Before running this script, install with pip the following packages: onnxruntime, tokenizers, numpy
+#
+#   python scripts/benchmark_int8.py -m sentence-transformers/all-MiniLM-L6-v2 --task embedding
+#   python scripts/benchmark_int8.py -m dbmdz/bert-large-cased-finetuned-conll03-english --task ner
+
+import argparse
+import os
+import time
+
+import numpy as np
+import onnxruntime as ort
+from tokenizers import Tokenizer
+
+SAMPLE_TEXTS = [
+    "PureCPP splits documents into chunks and embeds them for retrieval.",
+    "Angela Merkel met Emmanuel Macron in Paris to discuss the European budget.",
+    "The quarterly report shows revenue growth of twelve percent in Latin America.",
+    "Vector databases store embeddings and answer nearest-neighbour queries.",
+    "Microsoft and OpenAI announced a new partnership in Redmond, Washington.",
+    "Tokenization, inference and pooling dominate the cost of local embeddings.",
+    "The museum in Amsterdam reopened after a two-year renovation.",
+    "Quantized models trade a little accuracy for much higher CPU throughput.",
+]
+
+parser = argparse.ArgumentParser()
+parser.add_argument("-m", "--model_name", help="Model directory under models/.", required=True)
+parser.add_argument("--task", choices=["embedding", "ner"], default="embedding")
+parser.add_argument("--texts", help="Optional text file, one input per line.")
+parser.add_argument("--batch_size", type=int, default=16)
+parser.add_argument("--runs", type=int, default=5)
+parser.add_argument("--threads", type=int, default=0, help="Intra-op threads, 0 = onnxruntime default.")
+args = parser.parse_args()
+
+dir_path = os.path.join(os.path.dirname(__file__), "..", "models", args.model_name)
+fp32_path = os.path.join(dir_path, "model.onnx")
+int8_path = os.path.join(dir_path, "model.int8.onnx")
+tokenizer_path = os.path.join(dir_path, "tokenizer.json")
+if not os.path.exists(tokenizer_path):
+    tokenizer_path = os.path.join(dir_path, "tokenizer", "tokenizer.json")
+for path in (fp32_path, int8_path, tokenizer_path):
+    if not os.path.exists(path):
+        raise SystemExit(f"Missing {path}; export the model with hf_extract_model.py or hf_model_to_onnx.py first.")
+
+texts = SAMPLE_TEXTS * 8
+if args.texts:
+    with open(args.texts) as f:
+        texts = [line.strip() for line in f if line.strip()]
+
+tokenizer = Tokenizer.from_file(tokenizer_path)
+tokenizer.enable_padding()
+
+
+def load(path):
+    options = ort.SessionOptions()
+    options.graph_optimization_level = ort.GraphOptimizationLevel.ORT_ENABLE_ALL
+    options.inter_op_num_threads = 1
+    if args.threads > 0:
+        options.intra_op_num_threads = args.threads
+    return ort.InferenceSession(path, options, providers=["CPUExecutionProvider"])
+
+
+cls_pooling = "bge" in args.model_name.lower()
+
+
+def run(session, batch):
+    encoded = tokenizer.encode_batch(batch)
+    ids = np.array([e.ids for e in encoded], dtype=np.int64)
+    mask = np.array([e.attention_mask for e in encoded], dtype=np.int64)
+    feeds = {"input_ids": ids, "attention_mask": mask}
+    if "token_type_ids" in {i.name for i in session.get_inputs()}:
+        feeds["token_type_ids"] = np.zeros_like(ids)
+    output = session.run(None, feeds)[0]
+    if args.task == "embedding":
+        # Same pooling as ModelRegistry::PoolingFor: [CLS] for BGE models, else masked mean
+        # (Chunk::MeanPoolNormalize); then L2 normalization
+        if cls_pooling:
+            pooled = output[:, 0]
+        else:
+            pooled = (output * mask[..., None]).sum(axis=1)
+        return [pooled / np.maximum(np.linalg.norm(pooled, axis=1, keepdims=True), 1e-12)]
+    return [row.argmax(-1)[m.astype(bool)] for row, m in zip(output, mask)]
+
+
+def bench(session):
+    outputs = []
+    for i in range(0, len(texts), args.batch_size):
+        outputs.extend(run(session, texts[i:i + args.batch_size]))
+    best = float("inf")
+    for _ in range(args.runs):
+        start = time.perf_counter()
+        for i in range(0, len(texts), args.batch_size):
+            run(session, texts[i:i + args.batch_size])
+        best = min(best, time.perf_counter() - start)
+    return outputs, len(texts) / best
+
+
+fp32_out, fp32_tps = bench(load(fp32_path))
+int8_out, int8_tps = bench(load(int8_path))
+
+print(f"{'model':<8}{'size MB':>10}{'texts/s':>12}")
+print(f"{'fp32':<8}{os.path.getsize(fp32_path) / 2**20:>10.1f}{fp32_tps:>12.1f}")
+print(f"{'int8':<8}{os.path.getsize(int8_path) / 2**20:>10.1f}{int8_tps:>12.1f}")
+print(f"speedup: {int8_tps / fp32_tps:.2f}x")
+
+# Accuracy is measured on distinct inputs only
+first = list({text: i for i, text in reversed(list(enumerate(texts)))}.values())
+if args.task == "embedding":
+    a, b = np.concatenate(fp32_out)[first], np.concatenate(int8_out)[first]
+    cosine = (a * b).sum(axis=1)
+    # Retrieval agreement: does the INT8 model rank the same nearest neighbour?
+    same_top1 = ((a @ a.T - 2 * np.eye(len(a))).argmax(1) == (b @ b.T - 2 * np.eye(len(b))).argmax(1)).mean()
+    print(f"cosine(fp32, int8): mean {cosine.mean():.4f}, min {cosine.min():.4f}")
+    print(f"top-1 neighbour agreement: {same_top1 * 100:.1f}%")
+else:
+    agree = np.concatenate([fp32_out[i] == int8_out[i] for i in first])
+    print(f"token label agreement: {agree.mean() * 100:.2f}%")
@@ -8,6 +8,7 @@ if __name__ == "__main__":
     parser = argparse.ArgumentParser()
     parser.add_argument("-m", "--model_name", help="Put the model name.", required=True)
     # parser.add_argument("-o", "--output_name", help="Put the output name for the model after conversion.", required=True)
+    parser.add_argument("--no-quantize", action="store_true", help="Skip the dynamically quantized INT8 copy (model.int8.onnx).")
 
     args = parser.parse_args()
 
@@ -22,3 +23,10 @@ if __name__ == "__main__":
 
     model.save_pretrained(dir_path)
     tokenizer.save_pretrained(dir_path)
+
+    # Dynamic INT8 quantization of the MatMul/Gemm weights; picked automatically at load time
+    if not args.no_quantize:
+        from onnxruntime.quantization import quantize_dynamic, QuantType
+        int8_path = os.path.join(dir_path, "model.int8.onnx")
+        quantize_dynamic(os.path.join(dir_path, "model.onnx"), int8_path, weight_type=QuantType.QInt8, per_channel=True)
+        print(f"Quantized model exported to {int8_path}")
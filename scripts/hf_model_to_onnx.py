@@ -10,6 +10,7 @@ import os
 parser = argparse.ArgumentParser()
 parser.add_argument("-m", "--model_name", help="Put the model name.", required=True)
 parser.add_argument("-o", "--output_name", help="Put the output name for the model after conversion.", required=True)
+parser.add_argument("--no-quantize", action="store_true", help="Skip the dynamically quantized INT8 copy (model.int8.onnx).")
 
 args = parser.parse_args()
 
@@ -36,4 +37,11 @@ onnx_config = FeaturesManager.get_config(model_type=model_type,feature=feature)
 onnx_config = onnx_config(model.config)
 
 export(model=model, output=outpath_path, opset=14, preprocessor=tokenizer, config=onnx_config)
-print(f"Model exported to {outpath_path}")
\ No newline at end of file
+print(f"Model exported to {outpath_path}")
+
+# Dynamic INT8 quantization of the MatMul/Gemm weights; picked automatically at load time
+if not args.no_quantize:
+    from onnxruntime.quantization import quantize_dynamic, QuantType
+    int8_path = Path(f"{dir_path}/model.int8.onnx")
+    quantize_dynamic(outpath_path, int8_path, weight_type=QuantType.QInt8, per_channel=True)
+    print(f"Quantized model exported to {int8_path}")
@@ -35,8 +35,10 @@
 
 #include "ChunkDefault/ChunkDefault.h"
 #include "ChunkCount/ChunkCount.h"
+#include "ChunkTokens/ChunkTokens.h"
 #include "ChunkSimilarity/ChunkSimilarity.h"
 #include "ChunkCommons/ChunkCommons.h"
+#include "ChunkCommons/VendorRegistry.h"
 #include "ChunkQuery/ChunkQuery.h"
 
 #include "../components/MetadataExtractor/Document.h"
@@ -353,7 +355,58 @@ void bind_ChunkCommons(py::module& m)
     
     m.def("resolve_vendor_from_model", &Chunk::resolve_vendor_from_model);
     m.def("resolve_vendor", &Chunk::resolve_vendor);
+    m.def("list_embedding_vendors", [] { return Chunk::VendorRegistry::Instance().List(); },
+          "Vendors with an embedding handler (e.g. 'openai', and 'huggingface' for local ONNX models under models/).");
     m.def("to_lowercase", &Chunk::to_lowercase);
+    py::class_<Chunk::ChunkView>(m, "ChunkView", R"doc(
+            A chunk as a view (offset, length) into its shared source document.
+            The text is only copied into a Python string when page_content is read.
+
+            Attributes:
+                page_content (str): Chunk text (materialized on access).
+                metadata (Dict[str, str]): Metadata of the source document.
+                offset (int): Byte offset of the chunk in the source text.
+                length (int): Byte length of the chunk.
+        )doc")
+    .def_property_readonly("page_content", &Chunk::ChunkView::Str)
+    .def_property_readonly("metadata", &Chunk::ChunkView::GetMetadata)
+    .def_readonly("offset", &Chunk::ChunkView::offset)
+    .def_readonly("length", &Chunk::ChunkView::length)
+    .def("to_document", &Chunk::ChunkView::ToDocument)
+    .def("__len__", [](const Chunk::ChunkView &view) { return view.length; })
+    .def("__repr__", [](const Chunk::ChunkView &view) {
+        return "ChunkView(offset=" + std::to_string(view.offset) + ", length=" + std::to_string(view.length) + ")";
+    });
+
+    py::class_<Chunk::ChunkArena, std::shared_ptr<Chunk::ChunkArena>>(m, "ChunkArena", py::buffer_protocol(), R"doc(
+            All chunk texts packed in one UTF-8 buffer: chunk i is
+            bytes[offsets[i]:offsets[i + 1]]. Supports the buffer protocol, so
+            memoryview(arena) and numpy.frombuffer(arena, dtype=numpy.uint8)
+            read the texts without copying.
+
+            Attributes:
+                buffer (memoryview): Read-only view of the packed texts.
+                offsets (numpy.ndarray[uint64]): len(arena) + 1 chunk boundaries.
+                nbytes (int): Total size of the texts in bytes.
+        )doc")
+    .def_buffer([](const Chunk::ChunkArena &arena) {
+        return py::buffer_info(
+            const_cast<char *>(arena.bytes.data()), sizeof(uint8_t),
+            py::format_descriptor<uint8_t>::format(), 1,
+            {arena.bytes.size()}, {sizeof(uint8_t)}, true);
+    })
+    .def_property_readonly("buffer", [](py::object self) { return py::memoryview(self); })
+    .def_property_readonly("offsets", [](py::object self) {
+        const auto &arena = self.cast<const Chunk::ChunkArena &>();
+        return py::array_t<uint64_t>({arena.offsets.size()}, {sizeof(uint64_t)}, arena.offsets.data(), self);
+    })
+    .def_property_readonly("nbytes", [](const Chunk::ChunkArena &arena) { return arena.bytes.size(); })
+    .def("text", [](const Chunk::ChunkArena &arena, size_t i) {
+        const std::string_view text = arena.Text(i);
+        return py::str(text.data(), text.size());
+    }, py::arg("i"), "Text of chunk i as a str (one copy).")
+    .def("__len__", &Chunk::ChunkArena::size);
+
     py::class_<Chunk::vdb_data>(m, "VDBdata", R"doc(
             Represents an entry in the Vector DataBase.
 
@@ -363,13 +416,22 @@ void bind_ChunkCommons(py::module& m)
                 model (str): Model name.
                 dim (int): Embedding dimension.
                 n (int): Number of chunks.
+                row_of (List[int]): Chunk → flatVD row for deduplicated elements; empty otherwise.
+                reduction (str): "" for original embeddings, "pca" or "matryoshka" for reduced ones.
+                source_dim (int): Dimension of the embeddings this element was reduced from.
         )doc")
     .def(py::init<>())
     .def_readwrite("flatVD", &Chunk::vdb_data::flatVD)
     .def_readwrite("vendor", &Chunk::vdb_data::vendor)
     .def_readwrite("model", &Chunk::vdb_data::model)
     .def_readwrite("dim", &Chunk::vdb_data::dim)
-    .def_readwrite("n", &Chunk::vdb_data::n);
+    .def_readwrite("n", &Chunk::vdb_data::n)
+    .def_readonly("row_of", &Chunk::vdb_data::row_of)
+    .def("getRowCount", &Chunk::vdb_data::getRowCount)
+    .def_readonly("reduction", &Chunk::vdb_data::reduction)
+    .def_readonly("source_dim", &Chunk::vdb_data::source_dim)
+    .def("Project", &Chunk::vdb_data::Project, py::arg("embedding"),
+         "Maps a source_dim embedding into this element's (reduced) space.");
 
 
     //--------------------------------------------------------------------------
@@ -415,7 +477,7 @@ void bind_ChunkCommons(py::module& m)
                    batch_size (int, optional): Batch size (default=32).
 
                Returns:
-                   list[list[float]]: List of lists of embeddings.
+                   list[list[float]]: One mean-pooled, L2-normalized embedding per chunk.
            )doc");
  
     //--------------------------------------------------------------------------
@@ -481,6 +543,25 @@ void bind_ChunkCommons(py::module& m)
                    list[str]: List of resulting chunks.
            )doc");
  
+    //--------------------------------------------------------------------------
+    // Binding function for SplitTextRecursive
+    //--------------------------------------------------------------------------
+    m.def("SplitTextRecursive", &Chunk::SplitTextRecursive,
+        py::arg("inputs"), py::arg("overlap"), py::arg("chunk_size"),
+        R"doc(
+               Splits text into chunks of at most chunk_size bytes, cutting at the last
+               paragraph break, then sentence end, then whitespace that fits, and never
+               inside a UTF-8 code point. Overlaps start on a word boundary.
+
+               Parameters:
+                   inputs (str): Input text.
+                   overlap (int): Maximum number of bytes repeated from the previous chunk.
+                   chunk_size (int): Maximum size of each chunk.
+
+               Returns:
+                   list[str]: List of resulting chunks.
+           )doc");
+ 
     //--------------------------------------------------------------------------
     // Binding for the function SplitTextByCount
     //--------------------------------------------------------------------------
@@ -506,45 +587,76 @@ void bind_ChunkCommons(py::module& m)
 void bind_ChunkDefault(py::module& m)
 {
     py::class_<Chunk::ChunkDefault>(m, "ChunkDefault")
-        .def(py::init<int, int, std::optional<std::vector<RAGLibrary::Document>>, int>(),
+        .def(py::init<int, int, std::optional<std::vector<RAGLibrary::Document>>, int, bool>(),
              py::arg("chunk_size") = 100,
              py::arg("overlap") = 20,
              py::arg("items_opt") = std::nullopt,
-             py::arg("max_workers") = 4)
+             py::arg("max_workers") = 4,
+             py::arg("boundary_aware") = false)
 
         .def("ProcessDocuments", &Chunk::ChunkDefault::ProcessDocuments,
              py::arg("items_opt") = std::nullopt,
              py::arg("max_workers") = 4,
-             "Processes a list of documents into chunks.")
+             "Processes a list of documents into chunks (returned as ChunkView objects).")
+
+        .def("Append", &Chunk::ChunkDefault::Append,
+             py::arg("items"), py::arg("max_workers") = 4,
+             "Chunks new documents into an initialized ChunkDefault and embeds only their chunks for every existing element.")
+
+        .def("Reingest", &Chunk::ChunkDefault::Reingest,
+             py::arg("items"), py::arg("remove_missing") = false, py::arg("max_workers") = 4,
+             "Re-ingests documents keyed by metadata 'source': unchanged sources keep their chunks and embeddings, changed ones are re-chunked and only new chunk texts are embedded.")
 
         .def("CreateEmb", &Chunk::ChunkDefault::CreateEmb,
-             py::arg("model") = "text-embedding-ada-002",
+             py::arg("model") = "text-embedding-ada-002", py::arg("dedup") = false,
              py::return_value_policy::reference,
              "Creates and stores embeddings for the current chunks.")
 
+        .def("ProcessAndEmbed", &Chunk::ChunkDefault::ProcessAndEmbed,
+             py::arg("items"), py::arg("model") = "text-embedding-ada-002", py::arg("max_workers") = 4, py::arg("batch_size") = 256, py::arg("dedup") = false,
+             py::return_value_policy::reference,
+             "Chunks the documents and embeds them in one streaming pass: batches are embedded while later documents are still being split, and rows keep document order.")
+
+        .def("ReduceEmb", &Chunk::ChunkDefault::ReduceEmb,
+             py::arg("pos"), py::arg("dim"), py::arg("method") = "pca", py::arg("sample") = 4096,
+             py::return_value_policy::reference,
+             "Adds a reduced copy of element `pos` (PCA fitted on `sample` rows, or Matryoshka truncation), renormalized; ChunkQuery projects queries automatically.")
+
         .def("getflatVD", [](const Chunk::ChunkDefault &self, size_t idx) {
             const auto &vec = self.getFlatVD(idx);
             const auto *elem = self.getElement(idx);
             if (!elem) throw std::out_of_range("Invalid index for get_flat_vd");
 
-            size_t n = elem->n;
+            size_t n = elem->getRowCount();
             size_t dim = elem->dim;
             if (vec.size() != n * dim) throw std::runtime_error("Inconsistency in the flattened vector.");
+            if (elem->row_of.empty() && n != elem->n) throw std::runtime_error("Inconsistency in the flattened vector.");
 
-            return py::array_t<float>(
-                {n, dim},
-                {sizeof(float) * dim, sizeof(float)},
-                vec.data(),
-                py::cast(self)
-            );
+            // A copy: Append and Reingest reallocate flatVD, which would leave a view dangling
+            py::array_t<float> array({n, dim});
+            std::copy(vec.begin(), vec.end(), array.mutable_data());
+            return array;
         }, py::arg("idx"),
-        "Returns the flattened vector as a numpy array [n, dim].")
+        "Returns a copy of the flattened vector as a numpy array [rows, dim]; rows == n unless the element was deduplicated (see VDBdata.row_of).")
 
         .def("printVD", &Chunk::ChunkDefault::printVD)
         .def("clear", &Chunk::ChunkDefault::clear)
         .def("isInitialized", &Chunk::ChunkDefault::isInitialized)
         .def("quant_of_elements", &Chunk::ChunkDefault::quant_of_elements)
-        .def("getChunks", &Chunk::ChunkDefault::getChunks, py::return_value_policy::reference);
+        .def("getChunks", &Chunk::ChunkDefault::getChunkViews,
+             "Returns the chunks as ChunkView objects; page_content is materialized on access.")
+        .def("getChunkDocuments", &Chunk::ChunkDefault::getChunks, py::return_value_policy::reference,
+             "Returns the chunks materialized as RAGDocument objects.")
+        .def("getChunkArena", [](const Chunk::ChunkDefault &self, int max_workers) {
+            // The arena is immutable; Python shares ownership, so its buffers outlive later changes
+            return std::const_pointer_cast<Chunk::ChunkArena>(self.getChunkArena(max_workers));
+        }, py::arg("max_workers") = 4,
+             "Returns all chunk texts in one contiguous buffer with numpy offsets; no per-chunk Python objects are created. A snapshot: later changes to the chunks build a new arena.")
+        .def("PartitionBy", &Chunk::ChunkDefault::PartitionBy,
+             py::arg("field"),
+             "Builds one sub-index per value of the given chunk metadata field.")
+        .def("getPartitionKey", &Chunk::ChunkDefault::getPartitionKey)
+        .def("listPartitions", &Chunk::ChunkDefault::listPartitions);
 }
  
 //--------------------------------------------------------------------------
@@ -555,12 +667,51 @@ void bind_ChunkCount(py::module& m)
     py::class_<Chunk::ChunkCount>(m, "ChunkCount")
         .def(py::init<const std::string&, const int, const int>(),
             py::arg("count_unit"), py::arg("overlap") = 600, py::arg("count_threshold") = 1)
+        .def(py::init<const std::vector<std::string>&, const int, const int>(),
+            py::arg("count_units"), py::arg("overlap") = 600, py::arg("count_threshold") = 1,
+            "Counts occurrences of any of several units (plain strings or 'regex:' patterns) in one scan.")
         .def(py::init<>()) // Default constructor also exists
  
         .def("ProcessSingleDocument", &Chunk::ChunkCount::ProcessSingleDocument, py::arg("item"))
  
         .def("ProcessDocuments", &Chunk::ChunkCount::ProcessDocuments,
-            py::arg("items"), py::arg("max_workers") = 4);
+            py::arg("items"), py::arg("max_workers") = 4)
+
+        .def("ProcessDocumentViews", &Chunk::ChunkCount::ProcessDocumentViews,
+            py::arg("items"), py::arg("max_workers") = 4,
+            "Same chunks as ChunkView objects over shared document buffers.");
+}
+
+//--------------------------------------------------------------------------
+// Binding for ChunkTokens
+//--------------------------------------------------------------------------
+void bind_ChunkTokens(py::module& m)
+{
+    py::class_<Chunk::ChunkTokens>(m, "ChunkTokens", R"doc(
+        Splits documents into chunks measured in model tokens. chunk_tokens is the
+        model window including special tokens, so chunks fill it exactly; chunks
+        are byte ranges of the source text ending on word boundaries.
+    )doc")
+        .def(py::init<const std::string&, const int, const int>(),
+            py::arg("tokenizer") = "bge-small", py::arg("chunk_tokens") = 512, py::arg("overlap_tokens") = 64,
+            R"doc(
+                Parameters:
+                    tokenizer (str): Local model name ("bge-small"), directory under models/, or path to a tokenizer.json.
+                    chunk_tokens (int): Model window in tokens, special tokens included (default=512).
+                    overlap_tokens (int): Tokens repeated between neighbouring chunks (default=64).
+            )doc")
+
+        .def("ProcessSingleDocument", &Chunk::ChunkTokens::ProcessSingleDocument, py::arg("item"))
+
+        .def("ProcessDocuments", &Chunk::ChunkTokens::ProcessDocuments,
+            py::arg("items"), py::arg("max_workers") = 4)
+
+        .def("ProcessDocumentViews", &Chunk::ChunkTokens::ProcessDocumentViews,
+            py::arg("items"), py::arg("max_workers") = 4,
+            "Same chunks as ChunkView objects over shared document buffers.")
+
+        .def("getChunkTokens", &Chunk::ChunkTokens::getChunkTokens)
+        .def("getOverlapTokens", &Chunk::ChunkTokens::getOverlapTokens);
 }
  
 // --------------------------------------------------------------------------
@@ -571,43 +722,44 @@ void bind_ChunkSimilarity(py::module& m)
 {
  
     py::class_<Chunk::ChunkSimilarity>(m, "ChunkSimilarity", R"doc(
-        Class to process RAGDocuments and generate chunks and embeddings,
-        allowing for document similarity assessment. It has options to
-        define chunk size, overlap, embedding model (HuggingFace or OpenAI),
-        and an API key for OpenAI if needed.
+        Semantic chunker: splits documents into sentences, embeds each sentence
+        together with its neighbours (HuggingFace or OpenAI), and starts a new
+        chunk wherever the cosine distance between adjacent windows exceeds a
+        percentile of the document's distances. All documents are embedded in
+        one batch and memory stays linear in the number of sentences.
     )doc")
         .def(
-            py::init<int, int, std::string, const std::string&>(),
+            py::init<int, int, std::string, const std::string&, float, int>(),
             py::arg("chunk_size") = 100,
             py::arg("overlap") = 20,
             py::arg("embedding_model") = "openai",
             py::arg("openai_api_key") = "",
+            py::arg("breakpoint_percentile") = 95.0f,
+            py::arg("buffer_size") = 1,
             R"doc(
                 Constructor that initializes the ChunkSimilarity class.
 
                 Parameters:
-                    chunk_size (int): Default size of each text chunk (default=100).
-                    overlap (int): Overlap between successive chunks (default=20).
+                    chunk_size (int): Maximum size of a chunk in bytes (default=100).
+                    overlap (int): Overlap used when a single sentence exceeds chunk_size (default=20).
                     embedding_model (EmbeddingModel): Embedding model (HuggingFace or OpenAI).
-                    openai_api_key (str): OpenAI API key (only if embedding_model=OpenAI).
+                    openai_api_key (str): OpenAI API key (only if embedding_model=OpenAI; defaults to $OPENAI_API_KEY).
+                    breakpoint_percentile (float): Distance percentile above which a boundary is placed (default=95).
+                    buffer_size (int): Neighbouring sentences embedded on each side of a sentence (default=1).
             )doc")
         .def(
             "ProcessSingleDocument",
             &Chunk::ChunkSimilarity::ProcessSingleDocument,
             py::arg("item"),
             R"doc(
-                Given a single RAGDocument, splits its content into chunks
-                and generates embeddings according to the chosen model, returning
-                a vector of RAGLibrary::Document.
+                Splits a single RAGDocument into semantic chunks.
 
                 Parameters:
                     item (RAGDocument): Structure containing
                         the identifier and the textual content.
 
                 Returns:
-                    list[RAGDocument]: Vector of resulting documents,
-                    each with its chunked content and possibly
-                    with associated embeddings in its metadata.
+                    list[RAGDocument]: Chunks in text order, carrying the item's metadata.
             )doc")
         .def(
             "ProcessDocuments",
@@ -615,8 +767,9 @@ void bind_ChunkSimilarity(py::module& m)
             py::arg("items"),
             py::arg("max_workers") = 4,
             R"doc(
-                Similar to ProcessSingleDocument, but processes multiple
-                RAGDocuments in parallel (up to max_workers).
+                Same as ProcessSingleDocument for multiple RAGDocuments; sentence
+                splitting and grouping run in parallel (up to max_workers) and all
+                sentence windows are embedded in one batched call.
 
                 Parameters:
                     items (list[RAGDocument]): List of
@@ -625,8 +778,7 @@ void bind_ChunkSimilarity(py::module& m)
                         in parallel processing (default=4).
 
                 Returns:
-                    list[RAGDocument]: Concatenated list of documents
-                    resulting from the chunking of each item.
+                    list[RAGDocument]: Chunks of every item, in input order.
             )doc");
 }
 //--------------------------------------------------------------------------
@@ -634,6 +786,11 @@ void bind_ChunkSimilarity(py::module& m)
 //--------------------------------------------------------------------------
 
 void bind_ChunkQuery(py::module_& m) {
+    m.def("set_query_cache_capacity", [](size_t capacity) { Chunk::QueryEmbeddingCache::Instance().SetCapacity(capacity); },
+          py::arg("capacity"), "Maximum number of (model, query) embeddings kept by ChunkQuery (0 disables the cache).");
+    m.def("clear_query_cache", [] { Chunk::QueryEmbeddingCache::Instance().Clear(); },
+          "Drops all cached query embeddings.");
+
     py::class_<Chunk::ChunkQuery>(m, "ChunkQuery")
         .def(py::init<
             std::string,
@@ -673,7 +830,8 @@ void bind_ChunkQuery(py::module_& m) {
         .def("Retrieve", &Chunk::ChunkQuery::Retrieve,
             py::arg("threshold") = 0.5f,
             py::arg("chunks") = nullptr,
-            py::arg("pos") = std::nullopt
+            py::arg("pos") = std::nullopt,
+            py::arg("partition") = std::nullopt
         )
 
         .def("getQuery", &Chunk::ChunkQuery::getQuery)
@@ -1273,6 +1431,30 @@ void bind_IEmbeddingOpenAI(py::module &m)
  */
 void bind_EmbeddingOpenAI(py::module &m)
 {
+    py::class_<EmbeddingOpenAI::SchedulerOptions>(m, "OpenAISchedulerOptions", R"doc(
+            Concurrency, batch sizing and rate limits of the OpenAI embeddings requests.
+            An empty base_url falls back to $OPENAI_BASE_URL (e.g. a local mock server)
+            and then to https://api.openai.com/v1. Rate limits of 0 are unlimited.
+            Failed batches are retried individually with exponential backoff and jitter.
+        )doc")
+        .def(py::init<>())
+        .def_readwrite("base_url", &EmbeddingOpenAI::SchedulerOptions::baseUrl)
+        .def_readwrite("api_key", &EmbeddingOpenAI::SchedulerOptions::apiKey)
+        .def_readwrite("max_in_flight", &EmbeddingOpenAI::SchedulerOptions::maxInFlight)
+        .def_readwrite("max_inputs_per_batch", &EmbeddingOpenAI::SchedulerOptions::maxInputsPerBatch)
+        .def_readwrite("max_tokens_per_batch", &EmbeddingOpenAI::SchedulerOptions::maxTokensPerBatch)
+        .def_readwrite("requests_per_minute", &EmbeddingOpenAI::SchedulerOptions::requestsPerMinute)
+        .def_readwrite("tokens_per_minute", &EmbeddingOpenAI::SchedulerOptions::tokensPerMinute)
+        .def_readwrite("timeout_seconds", &EmbeddingOpenAI::SchedulerOptions::timeoutSeconds)
+        .def_readwrite("max_retries", &EmbeddingOpenAI::SchedulerOptions::maxRetries)
+        .def_readwrite("backoff_base_ms", &EmbeddingOpenAI::SchedulerOptions::backoffBaseMs)
+        .def_readwrite("backoff_max_ms", &EmbeddingOpenAI::SchedulerOptions::backoffMaxMs)
+        .def_readwrite("base64_transport", &EmbeddingOpenAI::SchedulerOptions::base64Transport);
+
+    m.def("set_openai_scheduler_options", &EmbeddingOpenAI::EmbeddingOpenAI::SetSchedulerOptions, py::arg("options"),
+          "Sets the scheduler options of every OpenAI embedding call in the process (CreateEmb, ProcessAndEmbed, Append, ChunkQuery, EmbeddingOpenAI).");
+    m.def("get_openai_scheduler_options", &EmbeddingOpenAI::EmbeddingOpenAI::GetSchedulerOptions);
+
     py::class_<EmbeddingOpenAI::EmbeddingOpenAI,
                std::shared_ptr<EmbeddingOpenAI::EmbeddingOpenAI>,
                EmbeddingOpenAI::IEmbeddingOpenAI>
@@ -1307,6 +1489,20 @@ void bind_EmbeddingOpenAI(py::module &m)
             the embeddings endpoint. Internally, this key will be
             configured in the client via openai::start(apiKey).
         )doc")
+        .def(
+            "SetSchedulerOptions",
+            [](EmbeddingOpenAI::EmbeddingOpenAI &, const EmbeddingOpenAI::SchedulerOptions &options)
+            { EmbeddingOpenAI::EmbeddingOpenAI::SetSchedulerOptions(options); },
+            py::arg("options"),
+            R"doc(
+            Sets how embedding requests are scheduled: requests in flight,
+            inputs and estimated tokens per request, requests/min and tokens/min.
+            The options are process-wide (same as set_openai_scheduler_options).
+        )doc")
+        .def(
+            "GetSchedulerOptions",
+            [](const EmbeddingOpenAI::EmbeddingOpenAI &)
+            { return EmbeddingOpenAI::EmbeddingOpenAI::GetSchedulerOptions(); })
         .def(
             "GenerateEmbeddings",
             &EmbeddingOpenAI::EmbeddingOpenAI::GenerateEmbeddings,
@@ -1315,7 +1511,8 @@ void bind_EmbeddingOpenAI(py::module &m)
             py::arg("batch_size") = 32,
             R"doc(
             Generates embeddings for a list of strings using the
-            "text-embedding-ada-002" model from OpenAI. It may raise
+            "text-embedding-ada-002" model from OpenAI. Several batches are
+            sent concurrently within the configured rate limits. It may raise
             a RagException if an error occurs in the JSON response.
 
             Parameters:
@@ -1408,6 +1605,7 @@ PYBIND11_MODULE(RagPUREAI, m)
     bind_ContentCleaner(m);
     bind_ChunkDefault(m);
     bind_ChunkCount(m);
+    bind_ChunkTokens(m);
     bind_ChunkQuery(m);
     bind_ChunkSimilarity(m);
     bind_EmbeddingDocument(m);